@@ -0,0 +1,472 @@
+//
+// Throughput benchmarks for jsonpp.
+//
+// Usage: jsonpp-bench [--time SECONDS] [FILE...]
+//
+// Without files, runs on synthetic documents shaped like the usual corpus (twitter.json,
+// canada.json, citm_catalog.json) plus an NDJSON stream. Files ending in .ndjson or .jsonl
+// are benchmarked with parse_lines; anything else as a single document.
+//
+
+#include "jsonpp.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace jsonpp;
+
+// Every global allocation is counted, so each benchmark can report allocations per document.
+static std::atomic<size_t> allocations(0);
+
+// Every replacement is kept out of line: once one side is inlined, GCC sees malloc()'s result reach
+// operator delete, or free() applied to operator new's, and warns about mismatched allocation.
+#if defined(__GNUC__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+
+BENCH_NOINLINE void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+BENCH_NOINLINE void* operator new[](size_t size) { return operator new(size); }
+
+BENCH_NOINLINE void operator delete(void* p) noexcept { std::free(p); }
+BENCH_NOINLINE void operator delete(void* p, size_t) noexcept { std::free(p); }
+BENCH_NOINLINE void operator delete[](void* p) noexcept { std::free(p); }
+BENCH_NOINLINE void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+static double min_time = 0.5;
+
+// Deterministic generator, so runs are comparable across machines and builds.
+class Random {
+    uint64_t state;
+
+public:
+    Random() : state(0x9e3779b97f4a7c15ULL) {}
+
+    uint64_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    int range(int lo, int hi) { return lo + static_cast<int>(next() % static_cast<uint64_t>(hi - lo + 1)); }
+    double real(double lo, double hi) { return lo + (hi - lo) * static_cast<double>(next() >> 11) / 9007199254740992.0; }
+};
+
+static std::string words(Random& rng, int n) {
+    static const char* vocab[] = {"the", "json", "parser", "benchmark", "\\u00e9t\\u00e9", "caf\xc3\xa9",
+                                  "\\\"quoted\\\"", "line\\nbreak", "stream", "\xe6\x97\xa5\xe6\x9c\xac", "tab\\t",
+                                  "RT", "@user", "#tag", "https:\\/\\/t.co\\/x"};
+    std::string out;
+    for (int i = 0; i < n; i++) {
+        if (i) out += ' ';
+        out += vocab[rng.next() % (sizeof(vocab) / sizeof(vocab[0]))];
+    }
+    return out;
+}
+
+// Many mid-sized objects with nested users, long strings with escapes and non-ASCII text.
+static std::string make_twitter() {
+    Random rng;
+    std::ostringstream out;
+    out << "{\"statuses\": [";
+    for (int i = 0; i < 1500; i++) {
+        if (i) out << ",";
+        out << "{\"created_at\": \"Sun Aug 31 00:29:15 +0000 2014\", \"id\": " << 505874924095815681LL + i
+            << ", \"id_str\": \"" << 505874924095815681LL + i << "\", \"text\": \"" << words(rng, rng.range(5, 25))
+            << "\", \"truncated\": false, \"in_reply_to_status_id\": null, \"user\": {\"id\": " << rng.range(1, 1 << 30)
+            << ", \"name\": \"" << words(rng, 2) << "\", \"screen_name\": \"user" << i
+            << "\", \"followers_count\": " << rng.range(0, 100000) << ", \"verified\": " << (i % 7 == 0 ? "true" : "false")
+            << ", \"profile_background_color\": \"C0DEED\", \"lang\": \"ja\"}, \"entities\": {\"hashtags\": [], "
+            << "\"urls\": [], \"user_mentions\": [{\"screen_name\": \"a\", \"indices\": [0, " << rng.range(2, 15)
+            << "]}]}, \"retweet_count\": " << rng.range(0, 500) << ", \"favorited\": false, \"lang\": \"ja\"}";
+    }
+    out << "], \"search_metadata\": {\"completed_in\": 0.087, \"count\": 1500}}";
+    return out.str();
+}
+
+// A few huge arrays of coordinate pairs: number parsing dominates.
+static std::string make_canada() {
+    Random rng;
+    std::ostringstream out;
+    out.precision(15);
+    out << "{\"type\": \"FeatureCollection\", \"features\": [{\"type\": \"Feature\", \"properties\": {\"name\": \"Canada\"}, "
+        << "\"geometry\": {\"type\": \"Polygon\", \"coordinates\": [";
+    for (int ring = 0; ring < 40; ring++) {
+        if (ring) out << ",";
+        out << "[";
+        for (int i = 0; i < 2800; i++) {
+            if (i) out << ",";
+            out << "[" << rng.real(-141.0, -52.0) << "," << rng.real(41.0, 83.0) << "]";
+        }
+        out << "]";
+    }
+    out << "]}}]}";
+    return out.str();
+}
+
+// Wide objects keyed by numeric ids and many small integer arrays: key handling dominates.
+static std::string make_citm() {
+    Random rng;
+    std::ostringstream out;
+    out << "{\"areaNames\": {";
+    for (int i = 0; i < 400; i++) out << (i ? "," : "") << "\"" << 205705993 + i << "\": \"" << words(rng, 3) << "\"";
+    out << "}, \"events\": {";
+    for (int i = 0; i < 2000; i++) {
+        out << (i ? "," : "") << "\"" << 138586341 + i << "\": {\"description\": null, \"id\": " << 138586341 + i
+            << ", \"logo\": \"/images/UE0AAAAACEKo6QAAAAZDSVRJ\", \"name\": \"" << words(rng, 4)
+            << "\", \"subTopicIds\": [" << 337184269 + i % 30 << ", " << 337184283 + i % 17
+            << "], \"subjectCode\": null, \"subtitle\": null, \"topicIds\": [" << 324846099 + i % 11 << ", "
+            << 107888604 + i % 5 << "]}";
+    }
+    out << "}, \"performances\": [";
+    for (int i = 0; i < 2000; i++) {
+        out << (i ? "," : "") << "{\"eventId\": " << 138586341 + i << ", \"id\": " << 339887544 + i
+            << ", \"prices\": [{\"amount\": " << rng.range(10, 200) * 500 << ", \"audienceSubCategoryId\": 337100890, "
+            << "\"seatCategoryId\": " << 338937295 + i % 3 << "}], \"seatCategories\": [{\"areas\": [{\"areaId\": "
+            << 205705999 + i % 40 << ", \"blockIds\": []}], \"seatCategoryId\": 338937295}], \"start\": "
+            << 1372701600000LL + i * 86400000LL << ", \"venueCode\": \"PLEYEL_PLEYEL\"}";
+    }
+    out << "]}";
+    return out.str();
+}
+
+// One small record per line, as produced by log shippers and event streams.
+static std::string make_ndjson() {
+    Random rng;
+    std::ostringstream out;
+    for (int i = 0; i < 50000; i++) {
+        out << "{\"ts\": " << 1700000000000LL + i * 17 << ", \"level\": \"" << (i % 10 ? "info" : "warn")
+            << "\", \"service\": \"api-" << i % 12 << "\", \"latency_ms\": " << rng.real(0.1, 250.0)
+            << ", \"ok\": " << (i % 13 ? "true" : "false") << ", \"msg\": \"" << words(rng, rng.range(2, 8))
+            << "\", \"tags\": [\"a\", \"b\"]}\n";
+    }
+    return out.str();
+}
+
+// The record make_ndjson() writes, for decoding straight into a struct.
+struct Event {
+    int64_t ts;
+    std::string level;
+    std::string service;
+    double latency_ms;
+    bool ok;
+    std::string msg;
+    std::vector<std::string> tags;
+};
+JSONPP_BIND(Event, ts, level, service, latency_ms, ok, msg, tags)
+
+static bool read_file(const std::string& path, std::string& out) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in) return false;
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    out = buffer.str();
+    return true;
+}
+
+static bool ends_with(const std::string& str, const char* suffix) {
+    size_t n = std::strlen(suffix);
+    return str.size() >= n && str.compare(str.size() - n, n, suffix) == 0;
+}
+
+// Seconds per call of f, repeated until min_time has elapsed; also reports allocations per call.
+template <typename F>
+static double measure(F f, double& allocs) {
+    typedef std::chrono::steady_clock clock;
+    f();  // warm up caches and node pools
+
+    size_t runs = 0;
+    size_t before = allocations.load();
+    clock::time_point start = clock::now();
+    double elapsed = 0;
+    do {
+        f();
+        runs++;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < min_time);
+
+    allocs = static_cast<double>(allocations.load() - before) / static_cast<double>(runs);
+    return elapsed / static_cast<double>(runs);
+}
+
+static void report(const std::string& corpus, const char* name, double seconds, size_t bytes, size_t ops, double allocs) {
+    char mbs[32] = "-";
+    if (bytes) std::snprintf(mbs, sizeof(mbs), "%.1f", static_cast<double>(bytes) / seconds / 1e6);
+    double ns = seconds * 1e9 / static_cast<double>(ops ? ops : 1);
+    std::printf("%-18s %-22s %10s %14.1f %12.1f\n", corpus.c_str(), name, mbs, ns, allocs);
+}
+
+static void collect(const JSONValue* node, std::vector<const JSONObject*>& out) {
+    if (const JSONObject* obj = dynamic_cast<const JSONObject*>(node)) {
+        out.push_back(obj);
+        for (JSONObject::iterator it = obj->begin(); it != obj->end(); ++it) collect(it->second, out);
+    } else if (const JSONArray* arr = dynamic_cast<const JSONArray*>(node)) {
+        for (JSONArray::iterator it = arr->begin(); it != arr->end(); ++it) collect(*it, out);
+    }
+}
+
+// A pointer to the last leaf, found by following the last member or element at each level.
+static std::string last_leaf(const JSONValue* node) {
+    std::string out;
+    for (;;) {
+        if (const JSONObject* obj = dynamic_cast<const JSONObject*>(node)) {
+            if (!obj->size()) break;
+            JSONObject::iterator it = obj->end() - 1;
+            out += '/';
+            for (const char* c = it->first.data(); c != it->first.data() + it->first.size(); ++c) {
+                if (*c == '~') out += "~0";
+                else if (*c == '/') out += "~1";
+                else out += *c;
+            }
+            node = it->second;
+        } else if (const JSONArray* arr = dynamic_cast<const JSONArray*>(node)) {
+            if (!arr->size()) break;
+            out += '/' + std::to_string(arr->size() - 1);
+            node = (*arr)[arr->size() - 1];
+        } else {
+            break;
+        }
+    }
+    return out;
+}
+
+static void bench_document(const std::string& corpus, const std::string& text) {
+    double allocs;
+    double t;
+    size_t n = text.size();
+
+    t = measure([&]() { delete parse(text); }, allocs);
+    report(corpus, "parse", t, n, 1, allocs);
+
+    t = measure([&]() { Document doc; doc.parse(text); }, allocs);
+    report(corpus, "parse (document)", t, n, 1, allocs);
+
+    ParseOptions compact;
+    compact.compact_arrays = true;
+    t = measure([&]() { delete parse(text, compact); }, allocs);
+    report(corpus, "parse (compact)", t, n, 1, allocs);
+
+    ParseOptions unchecked;
+    unchecked.validate_utf8 = false;
+    t = measure([&]() { delete parse(text, unchecked); }, allocs);
+    report(corpus, "parse (no UTF-8)", t, n, 1, allocs);
+
+    ParseOptions indexed;
+    indexed.indexed = true;
+    t = measure([&]() { delete parse(text, indexed); }, allocs);
+    report(corpus, "parse (indexed)", t, n, 1, allocs);
+
+    t = measure([&]() { Document doc; doc.parse(text, indexed); }, allocs);
+    report(corpus, "parse (document, idx)", t, n, 1, allocs);
+
+    std::vector<uint32_t> tape;
+    t = measure([&]() {
+        tape.clear();
+        detail::structural_index(text.data(), text.size(), tape);
+    }, allocs);
+    report(corpus, "structural index", t, n, 1, allocs);
+
+    t = measure([&]() { LazyDocument lazy(text); (void)lazy.root().type(); }, allocs);
+    report(corpus, "lazy index", t, n, 1, allocs);
+
+    std::unique_ptr<JSONValue> root(parse(text));
+    std::string out = root->to_string();
+
+    t = measure([&]() { out = root->to_string(); }, allocs);
+    report(corpus, "to_string", t, out.size(), 1, allocs);
+
+    std::string escaped;
+    t = measure([&]() { escaped.clear(); escape_str(text.data(), text.size(), escaped); }, allocs);
+    report(corpus, "escape_str", t, n, 1, allocs);
+
+    volatile bool valid;
+    t = measure([&]() { valid = valid_utf8(text); }, allocs);
+    report(corpus, "valid_utf8", t, n, 1, allocs);
+
+    std::string binary = to_binary(*root);
+    t = measure([&]() { binary = to_binary(*root); }, allocs);
+    report(corpus, "to_binary", t, binary.size(), 1, allocs);
+
+    t = measure([&]() { delete from_binary(binary); }, allocs);
+    report(corpus, "from_binary", t, binary.size(), 1, allocs);
+
+    t = measure([&]() { delete root->clone(); }, allocs);
+    report(corpus, "clone + destroy", t, n, 1, allocs);
+
+    // Destruction alone: parse outside the timed region, then free.
+    {
+        typedef std::chrono::steady_clock clock;
+        double total = 0;
+        size_t runs = 0;
+        while (total < min_time) {
+            JSONValue* tree = parse(text);
+            clock::time_point start = clock::now();
+            delete tree;
+            total += std::chrono::duration<double>(clock::now() - start).count();
+            runs++;
+        }
+        report(corpus, "destroy", total / static_cast<double>(runs), n, 1, 0);
+    }
+
+    std::vector<const JSONObject*> objects;
+    collect(root.get(), objects);
+    size_t lookups = 0;
+    for (const JSONObject* obj : objects) lookups += obj->size();
+    if (lookups) {
+        size_t found = 0;
+        t = measure([&]() {
+            for (const JSONObject* obj : objects) {
+                for (JSONObject::iterator it = obj->begin(); it != obj->end(); ++it) {
+                    found += obj->find(StringRef(it->first.data(), it->first.size())) != obj->end();
+                }
+            }
+        }, allocs);
+        report(corpus, "object lookup", t, 0, lookups, allocs / static_cast<double>(lookups));
+        if (!found) std::printf("lookup failed\n");
+    }
+
+    JSONPointer pointer(last_leaf(root.get()));
+    const JSONValue* leaf = nullptr;
+    t = measure([&]() { leaf = pointer.find(root.get()); }, allocs);
+    report(corpus, "pointer find", t, 0, 1, allocs);
+    if (!leaf) std::printf("pointer failed\n");
+
+    LazyDocument lazy(text);
+    t = measure([&]() { delete pointer.at(lazy.root()).materialize(); }, allocs);
+    report(corpus, "pointer at (lazy)", t, 0, 1, allocs);
+}
+
+static void bench_lines(const std::string& corpus, const std::string& text) {
+    size_t records = 0;
+    for (char c : text) records += c == '\n';
+    if (!records) records = 1;
+
+    double allocs;
+    double t;
+    LineOptions single;
+    single.threads = 1;
+    t = measure([&]() { parse_lines(text, [](JSONValue* v) { delete v; }, single); }, allocs);
+    report(corpus, "parse_lines (1)", t, text.size(), records, allocs / static_cast<double>(records));
+
+    LineOptions single_indexed = single;
+    single_indexed.parse.indexed = true;
+    t = measure([&]() { parse_lines(text, [](JSONValue* v) { delete v; }, single_indexed); }, allocs);
+    report(corpus, "parse_lines (1, idx)", t, text.size(), records, allocs / static_cast<double>(records));
+
+    LineOptions all;
+    t = measure([&]() { parse_lines(text, [](JSONValue* v) { delete v; }, all); }, allocs);
+    report(corpus, "parse_lines (all)", t, text.size(), records, allocs / static_cast<double>(records));
+
+    LineOptions all_indexed;
+    all_indexed.parse.indexed = true;
+    t = measure([&]() { parse_lines(text, [](JSONValue* v) { delete v; }, all_indexed); }, allocs);
+    report(corpus, "parse_lines (all, idx)", t, text.size(), records, allocs / static_cast<double>(records));
+}
+
+// Fixed-schema records decoded through the DOM and through a JSONPP_BIND struct.
+static void bench_binding(const std::string& corpus, const std::string& text) {
+    std::vector<std::pair<const char*, size_t> > lines;
+    for (size_t pos = 0, next; pos < text.size(); pos = next + 1) {
+        next = text.find('\n', pos);
+        if (next == std::string::npos) next = text.size();
+        lines.push_back(std::make_pair(text.data() + pos, next - pos));
+    }
+
+    double allocs;
+    double t;
+    double records = static_cast<double>(lines.size());
+    t = measure([&]() {
+        for (auto& line : lines) delete parse(line.first, line.second);
+    }, allocs);
+    report(corpus, "parse (records)", t, text.size(), lines.size(), allocs / records);
+
+    Event event;
+    t = measure([&]() {
+        for (auto& line : lines) from_json(line.first, line.second, event);
+    }, allocs);
+    report(corpus, "from_json (records)", t, text.size(), lines.size(), allocs / records);
+
+    t = measure([&]() {
+        for (auto& line : lines) {
+            std::unique_ptr<JSONValue> tree(parse(line.first, line.second));
+            (void)tree->to_string();
+        }
+    }, allocs);
+    report(corpus, "parse + to_string", t, text.size(), lines.size(), allocs / records);
+
+    t = measure([&]() { (void)to_json(event); }, allocs);
+    report(corpus, "to_json (record)", t, 0, 1, allocs);
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::pair<std::string, std::string>> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--time" && i + 1 < argc) {
+            min_time = std::atof(argv[++i]);
+            continue;
+        }
+        std::string text;
+        if (!read_file(arg, text)) {
+            std::fprintf(stderr, "cannot read %s\n", arg.c_str());
+            return 1;
+        }
+        inputs.push_back(std::make_pair(arg, text));
+    }
+
+    bool synthetic = inputs.empty();
+    if (synthetic) {
+        inputs.push_back(std::make_pair(std::string("twitter (synth)"), make_twitter()));
+        inputs.push_back(std::make_pair(std::string("canada (synth)"), make_canada()));
+        inputs.push_back(std::make_pair(std::string("citm (synth)"), make_citm()));
+        // Indented output, where whitespace is a large share of the bytes.
+        std::unique_ptr<JSONValue> citm(parse(inputs.back().second));
+        inputs.push_back(std::make_pair(std::string("citm (pretty)"), citm->to_string(Format::pretty())));
+        inputs.push_back(std::make_pair(std::string("events.ndjson"), make_ndjson()));
+    }
+
+    std::printf("%-18s %-22s %10s %14s %12s\n", "corpus", "benchmark", "MB/s", "ns/op", "allocs/op");
+    for (size_t i = 0; i < inputs.size(); i++) {
+        const std::string& name = inputs[i].first;
+        const std::string& text = inputs[i].second;
+        try {
+            if (ends_with(name, ".ndjson") || ends_with(name, ".jsonl")) bench_lines(name, text);
+            else bench_document(name, text);
+            if (synthetic && name == "events.ndjson") bench_binding(name, text);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s: %s\n", name.c_str(), e.what());
+            return 1;
+        }
+    }
+
+#ifndef _WIN32
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    std::printf("peak RSS: %.1f MB\n", static_cast<double>(usage.ru_maxrss) / 1e6);
+#else
+    std::printf("peak RSS: %.1f MB\n", static_cast<double>(usage.ru_maxrss) / 1e3);
+#endif
+#endif
+    return 0;
+}
@@ -27,309 +27,6285 @@
 
 #include <string>
 #include <vector>
-#include <map>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
 #include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+#include <cmath>
+#include <new>
+#include <ostream>
 #include <stdint.h>
 
+#if __cplusplus >= 201703L
+#  include <string_view>
+#endif
+
+#if defined(JSONPP_INSTRUMENTATION)
+#  include <chrono>
+#endif
+
+#if !defined(JSONPP_NO_SIMD)
+#  if defined(__AVX2__)
+#    define JSONPP_AVX2 1
+#  endif
+#  if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define JSONPP_SSE2 1
+#  endif
+#  if defined(__ARM_NEON) && defined(__aarch64__)
+#    define JSONPP_NEON 1
+#  endif
+#endif
+
+// On x86 with GCC or Clang, the structural indexer also carries AVX2 and AVX-512 kernels compiled with
+// target attributes and picks one at run time, so a baseline build still uses the widest unit available.
+#if !defined(JSONPP_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define JSONPP_DISPATCH 1
+#  define JSONPP_TARGET(isa) __attribute__((target(isa)))
+#else
+#  define JSONPP_TARGET(isa)
+#endif
+
+#if defined(JSONPP_AVX2) || defined(JSONPP_DISPATCH)
+#  include <immintrin.h>
+#elif defined(JSONPP_SSE2)
+#  include <emmintrin.h>
+#elif defined(JSONPP_NEON)
+#  include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+#if defined(_WIN32)
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#else
+#  include <cerrno>
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
 namespace jsonpp {
 
-    std::string escape_str(const std::string& str) {
-        std::string out;
+    class parse_error : public std::runtime_error {
+        std::string msg;
+        size_t pos;
+
+    public:
+        parse_error(const std::string& what, size_t offset)
+                : std::runtime_error(what + " at offset " + std::to_string(offset)), msg(what), pos(offset) {}
+
+        size_t offset() const { return pos; }
+
+        // The description without the position.
+        const std::string& message() const { return msg; }
+    };
+
+    namespace detail {
+
+        inline unsigned ctz32(uint32_t x) {
+#if defined(_MSC_VER)
+            unsigned long i;
+            _BitScanForward(&i, x);
+            return static_cast<unsigned>(i);
+#else
+            return static_cast<unsigned>(__builtin_ctz(x));
+#endif
+        }
+
+        inline unsigned ctz64(uint64_t x) {
+#if defined(_MSC_VER) && defined(_M_X64)
+            unsigned long i;
+            _BitScanForward64(&i, x);
+            return static_cast<unsigned>(i);
+#elif defined(_MSC_VER)
+            return static_cast<uint32_t>(x) ? ctz32(static_cast<uint32_t>(x)) : 32 + ctz32(static_cast<uint32_t>(x >> 32));
+#else
+            return static_cast<unsigned>(__builtin_ctzll(x));
+#endif
+        }
+
+        template <bool Slash>
+        inline bool is_special(char c) {
+            return c == '"' || c == '\\' || (Slash && c == '/') || static_cast<unsigned char>(c) < 0x20;
+        }
+
+        // Returns the first quote, backslash or control byte in [p, end), or end if there is none.
+        // With Slash set, '/' is also treated as special, matching what escape_str escapes.
+        template <bool Slash>
+        inline const char* find_special(const char* p, const char* end) {
+#if defined(JSONPP_AVX2)
+            const __m256i quote32 = _mm256_set1_epi8('"');
+            const __m256i slash32 = _mm256_set1_epi8('\\');
+            const __m256i ctrl32 = _mm256_set1_epi8(0x1F);
+            const __m256i solidus32 = _mm256_set1_epi8('/');
+            while (end - p >= 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                __m256i hit = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_cmpeq_epi8(v, quote32), _mm256_cmpeq_epi8(v, slash32)),
+                        _mm256_cmpeq_epi8(_mm256_max_epu8(v, ctrl32), ctrl32));
+                if (Slash) hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, solidus32));
+                uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+                if (mask) return p + ctz32(mask);
+                p += 32;
+            }
+#endif
+#if defined(JSONPP_SSE2)
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i slash = _mm_set1_epi8('\\');
+            const __m128i ctrl = _mm_set1_epi8(0x1F);
+            const __m128i solidus = _mm_set1_epi8('/');
+            while (end - p >= 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                __m128i hit = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)),
+                        _mm_cmpeq_epi8(_mm_max_epu8(v, ctrl), ctrl));
+                if (Slash) hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, solidus));
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hit));
+                if (mask) return p + ctz32(mask);
+                p += 16;
+            }
+#elif defined(JSONPP_NEON)
+            const uint8x16_t quote = vdupq_n_u8('"');
+            const uint8x16_t slash = vdupq_n_u8('\\');
+            const uint8x16_t ctrl = vdupq_n_u8(0x20);
+            const uint8x16_t solidus = vdupq_n_u8('/');
+            while (end - p >= 16) {
+                uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+                uint8x16_t hit = vorrq_u8(vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, slash)), vcltq_u8(v, ctrl));
+                if (Slash) hit = vorrq_u8(hit, vceqq_u8(v, solidus));
+                if (vmaxvq_u8(hit)) {
+                    // Narrow each byte lane to a nibble so the first hit can be found with one ctz.
+                    uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hit), 4)), 0);
+                    return p + (ctz64(mask) >> 2);
+                }
+                p += 16;
+            }
+#endif
+            while (p != end && !is_special<Slash>(*p)) ++p;
+            return p;
+        }
+
+        inline const char* find_string_special(const char* p, const char* end) {
+            return find_special<false>(p, end);
+        }
+
+        inline const char* find_escape_special(const char* p, const char* end) {
+            return find_special<true>(p, end);
+        }
+
+        // --- UTF-8 ---
+
+        static const uint32_t invalid_utf8 = 0xFFFFFFFF;
+
+        // Decodes the character at p and steps over it. Follows RFC 3629: overlong forms, surrogates and
+        // code points past U+10FFFF are invalid, in which case invalid_utf8 is returned and p is left
+        // unchanged.
+        inline uint32_t decode_utf8(const char*& p, const char* end) {
+            const unsigned char* s = reinterpret_cast<const unsigned char*>(p);
+            size_t left = static_cast<size_t>(end - p);
+            unsigned char c = s[0];
+            if (c < 0x80) {
+                ++p;
+                return c;
+            }
+
+            size_t n;
+            uint32_t cp;
+            unsigned char lo = 0x80, hi = 0xBF;
+            if (c < 0xC2) return invalid_utf8;
+            if (c < 0xE0) {
+                n = 2;
+                cp = c & 0x1F;
+            } else if (c < 0xF0) {
+                n = 3;
+                cp = c & 0x0F;
+                if (c == 0xE0) lo = 0xA0;
+                if (c == 0xED) hi = 0x9F;
+            } else if (c < 0xF5) {
+                n = 4;
+                cp = c & 0x07;
+                if (c == 0xF0) lo = 0x90;
+                if (c == 0xF4) hi = 0x8F;
+            } else {
+                return invalid_utf8;
+            }
+
+            if (left < n || s[1] < lo || s[1] > hi) return invalid_utf8;
+            for (size_t i = 1; i < n; i++) {
+                if ((s[i] & 0xC0) != 0x80) return invalid_utf8;
+                cp = (cp << 6) | (s[i] & 0x3F);
+            }
+            p += n;
+            return cp;
+        }
+
+        inline const char* find_invalid_utf8_scalar(const char* p, const char* end) {
+            while (p != end) {
+                if (end - p >= 8) {
+                    uint64_t word;
+                    std::memcpy(&word, p, sizeof(word));
+                    if (!(word & 0x8080808080808080ULL)) {
+                        p += 8;
+                        continue;
+                    }
+                }
+                if (decode_utf8(p, end) == invalid_utf8) return p;
+            }
+            return end;
+        }
+
+#if defined(JSONPP_AVX2) || defined(JSONPP_DISPATCH)
+        // Lookup-table validation (Keiser and Lemire, "Validating UTF-8 in less than one instruction per
+        // byte"): three 16-entry tables, indexed by the high and low nibble of each byte and the high
+        // nibble of the next, flag every invalid pair of adjacent bytes; the lengths of 3- and 4-byte
+        // sequences are checked separately. Blocks of ASCII only check that nothing was left incomplete.
+        JSONPP_TARGET("avx2") inline __m256i utf8_block_errors(__m256i input, __m256i prev_input) {
+            const char too_short = 1 << 0, too_long = 1 << 1, overlong_3 = 1 << 2, too_large = 1 << 3;
+            const char surrogate = 1 << 4, overlong_2 = 1 << 5, too_large_1000 = 1 << 6, overlong_4 = 1 << 6;
+            const char two_conts = static_cast<char>(1 << 7);
+            const char carry = too_short | too_long | two_conts;
+            const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+            __m256i prev1 = _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev_input, input, 0x21), 15);
+            __m256i byte_1_high = _mm256_shuffle_epi8(
+                    _mm256_setr_epi8(too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+                                     two_conts, two_conts, two_conts, two_conts, too_short | overlong_2, too_short,
+                                     too_short | overlong_3 | surrogate, too_short | too_large | too_large_1000 | overlong_4,
+                                     too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+                                     two_conts, two_conts, two_conts, two_conts, too_short | overlong_2, too_short,
+                                     too_short | overlong_3 | surrogate, too_short | too_large | too_large_1000 | overlong_4),
+                    _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+            const char large = carry | too_large | too_large_1000;
+            __m256i byte_1_low = _mm256_shuffle_epi8(
+                    _mm256_setr_epi8(carry | overlong_3 | overlong_2 | overlong_4, carry | overlong_2, carry, carry,
+                                     carry | too_large, large, large, large, large, large, large, large, large,
+                                     large | surrogate, large, large,
+                                     carry | overlong_3 | overlong_2 | overlong_4, carry | overlong_2, carry, carry,
+                                     carry | too_large, large, large, large, large, large, large, large, large,
+                                     large | surrogate, large, large),
+                    _mm256_and_si256(prev1, nibble));
+            const char cont_1000 = too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4;
+            const char cont_1001 = too_long | overlong_2 | two_conts | overlong_3 | too_large;
+            const char cont_101 = too_long | overlong_2 | two_conts | surrogate | too_large;
+            __m256i byte_2_high = _mm256_shuffle_epi8(
+                    _mm256_setr_epi8(too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+                                     cont_1000, cont_1001, cont_101, cont_101, too_short, too_short, too_short, too_short,
+                                     too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+                                     cont_1000, cont_1001, cont_101, cont_101, too_short, too_short, too_short, too_short),
+                    _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+            __m256i special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+            __m256i shifted = _mm256_permute2x128_si256(prev_input, input, 0x21);
+            __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+            __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+            __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+            __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+            __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+            return _mm256_xor_si256(must23, special);
+        }
+
+        // Leading bytes in the last three positions that still expect continuations.
+        JSONPP_TARGET("avx2") inline __m256i utf8_incomplete(__m256i input) {
+            const __m256i max = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                 -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                 static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1),
+                                                 static_cast<char>(0xC0 - 1));
+            return _mm256_subs_epu8(input, max);
+        }
+
+        // Validates 32 bytes at a time. At the first block with an error, the scalar decoder takes over
+        // from the last character boundary before it to find the exact offending byte.
+        JSONPP_TARGET("avx2") inline const char* find_invalid_utf8_avx2(const char* p, const char* end) {
+            const char* begin = p;
+            __m256i prev_input = _mm256_setzero_si256();
+            __m256i prev_incomplete = _mm256_setzero_si256();
+
+            for (;;) {
+                const char* block = p;
+                __m256i input;
+                bool last = end - p < 32;
+                if (!last) {
+                    input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                    p += 32;
+                } else {
+                    // The zero padding is ASCII, so a sequence cut off by the end shows up as too short.
+                    char tail[32] = {0};
+                    std::memcpy(tail, p, static_cast<size_t>(end - p));
+                    input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tail));
+                }
+
+                __m256i error;
+                if (!_mm256_movemask_epi8(input)) {
+                    error = prev_incomplete;
+                } else {
+                    error = utf8_block_errors(input, prev_input);
+                    prev_incomplete = utf8_incomplete(input);
+                }
+                if (!_mm256_testz_si256(error, error)) {
+                    const char* q = block;
+                    for (int i = 0; i < 3 && q != begin; i++) --q;
+                    while (q != block && (static_cast<unsigned char>(*q) & 0xC0) == 0x80) ++q;
+                    return find_invalid_utf8_scalar(q, end);
+                }
+                if (last) return end;
+                prev_input = input;
+            }
+        }
+#endif
+
+        typedef const char* (*utf8_fn)(const char* p, const char* end);
+
+        // Returns the first byte of [p, end) that does not start a valid UTF-8 character, or end.
+        inline const char* find_invalid_utf8(const char* p, const char* end) {
+            // Most strings are short; not worth setting up vectors for.
+            if (end - p < 64) return find_invalid_utf8_scalar(p, end);
+#if defined(JSONPP_DISPATCH)
+            static const utf8_fn fn = [] {
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2") ? &find_invalid_utf8_avx2 : &find_invalid_utf8_scalar;
+            }();
+            return fn(p, end);
+#elif defined(JSONPP_AVX2)
+            return find_invalid_utf8_avx2(p, end);
+#else
+            return find_invalid_utf8_scalar(p, end);
+#endif
+        }
+
+        // Throws parse_error at the first invalid byte of [p, end); offsets are relative to base.
+        inline void check_utf8(const char* p, const char* end, const char* base) {
+            const char* bad = find_invalid_utf8(p, end);
+            if (bad != end) throw parse_error("invalid UTF-8", bad - base);
+        }
+
+        inline int hex_value(char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        inline void append_utf8(std::string& out, uint32_t cp) {
+            if (cp < 0x80) {
+                out.push_back(static_cast<char>(cp));
+            } else if (cp < 0x800) {
+                out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+            } else if (cp < 0x10000) {
+                out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+            } else {
+                out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+            }
+        }
+
+        inline uint32_t read_hex4(const char* p, const char* end, const char* base) {
+            if (end - p < 4) throw parse_error("truncated \\u escape", p - base);
+
+            uint32_t cp = 0;
+            for (int i = 0; i < 4; i++) {
+                int h = hex_value(p[i]);
+                if (h < 0) throw parse_error("invalid \\u escape", p + i - base);
+                cp = (cp << 4) | static_cast<uint32_t>(h);
+            }
+            return cp;
+        }
+
+        // Appends the unescaped form of [p, end) to out, stopping at the first unescaped '"'.
+        // Returns a pointer to that quote, or end if there is none. Offsets in errors are relative to base.
+        // \u escapes of surrogate pairs are combined into one character; when strict, a surrogate
+        // without its other half is an error, otherwise it is encoded on its own. Once out would grow
+        // past limit bytes, stops early with out one byte over it.
+        inline const char* unescape(const char* p, const char* end, std::string& out, const char* base,
+                                    bool strict = true, size_t limit = SIZE_MAX) {
+            while (p != end) {
+                if (out.size() > limit) return p;
+                const char* run = p;
+                p = find_string_special(p, end);
+                if (static_cast<size_t>(p - run) > limit - out.size()) {
+                    out.append(run, limit - out.size() + 1);
+                    return p;
+                }
+                out.append(run, p);
+
+                if (p == end || *p == '"') return p;
+                if (*p != '\\') throw parse_error("unescaped control character in string", p - base);
+
+                if (++p == end) throw parse_error("truncated escape sequence", p - base);
+                switch (*p++) {
+                    case '"':  out.push_back('"'); break;
+                    case '\\': out.push_back('\\'); break;
+                    case '/':  out.push_back('/'); break;
+                    case 'b':  out.push_back('\b'); break;
+                    case 'f':  out.push_back('\f'); break;
+                    case 'n':  out.push_back('\n'); break;
+                    case 'r':  out.push_back('\r'); break;
+                    case 't':  out.push_back('\t'); break;
+                    case 'u': {
+                        const char* escape = p - 2;
+                        uint32_t cp = read_hex4(p, end, base);
+                        p += 4;
+                        if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                            uint32_t lo = read_hex4(p + 2, end, base);
+                            if (lo >= 0xDC00 && lo < 0xE000) {
+                                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                                p += 6;
+                            }
+                        }
+                        if (strict && cp >= 0xD800 && cp < 0xE000) {
+                            throw parse_error("invalid surrogate escape", escape - base);
+                        }
+                        append_utf8(out, cp);
+                        break;
+                    }
+                    default:
+                        throw parse_error("invalid escape sequence", p - 1 - base);
+                }
+            }
+            return p;
+        }
+
+    }
+
+    // Non-owning view of a run of characters, for lookups that should not build a std::string.
+    class StringRef {
+        const char* ptr;
+        size_t len;
+
+    public:
+        StringRef(const char* str) : ptr(str), len(std::strlen(str)) {}
+        StringRef(const char* str, size_t n) : ptr(str), len(n) {}
+        StringRef(const std::string& str) : ptr(str.data()), len(str.size()) {}
+#if __cplusplus >= 201703L
+        StringRef(std::string_view str) : ptr(str.data()), len(str.size()) {}
+#endif
+
+        const char* data() const { return ptr; }
+        size_t size() const { return len; }
+    };
+
+    // Layout of serialized output. The default puts everything on one line with a space after each
+    // ',' and ':'; compact() drops the spaces and pretty() breaks lines and indents each level.
+    struct Format {
+        // Spaces per nesting level; zero keeps the output on one line.
+        unsigned indent;
+
+        // On one-line output, follow ',' and ':' with a space.
+        bool spaced;
+
+        // Escape every non-ASCII character as \uXXXX (a surrogate pair past U+FFFF), so the output is
+        // plain ASCII. Bytes that are not valid UTF-8 are written as \ufffd.
+        bool ascii;
+
+        Format() : indent(0), spaced(true), ascii(false) {}
+
+        static Format compact() {
+            Format f;
+            f.spaced = false;
+            return f;
+        }
+
+        static Format pretty(unsigned indent = 4) {
+            Format f;
+            f.indent = indent;
+            return f;
+        }
+    };
+
+    // Output sink for serialize(). Implementations append bytes to wherever they write. Containers lay
+    // out their punctuation through open(), separator(), key_separator() and close(), which follow format().
+    class Writer {
+        Format fmt;
+        size_t depth;
+
+        void newline() {
+            static const char spaces[] = "                                                                ";
+            put('\n');
+            for (size_t n = depth * fmt.indent; n;) {
+                size_t chunk = std::min(n, sizeof(spaces) - 1);
+                write(spaces, chunk);
+                n -= chunk;
+            }
+        }
+
+    public:
+        Writer() : depth(0) {}
+
+        virtual void write(const char* data, size_t len) = 0;
+        virtual void put(char c) { write(&c, 1); }
+
+        // Hint that about len more bytes are coming; sinks that can grow ahead of time should.
+        virtual void reserve(size_t) {}
+
+        void write(const char* str) { write(str, std::strlen(str)); }
+        void write(const std::string& str) { write(str.data(), str.size()); }
+
+        const Format& format() const { return fmt; }
+
+        // Lays out what follows in format, as if already nested level containers deep.
+        void set_format(const Format& format, size_t level = 0) {
+            fmt = format;
+            depth = level;
+        }
+
+        void open(char bracket) {
+            put(bracket);
+            ++depth;
+        }
+
+        // Before each element or member; first is true for the first one in its container.
+        void separator(bool first) {
+            if (!first) put(',');
+            if (fmt.indent) newline();
+            else if (!first && fmt.spaced) put(' ');
+        }
+
+        void key_separator() {
+            if (fmt.indent || fmt.spaced) write(": ", 2);
+            else put(':');
+        }
+
+        void close(char bracket, bool empty) {
+            --depth;
+            if (fmt.indent && !empty) newline();
+            put(bracket);
+        }
+
+        virtual ~Writer() {}
+    };
+
+    class StringWriter : public Writer {
+        std::string& out;
+
+    public:
+        explicit StringWriter(std::string& str) : out(str) {}
+
+        void write(const char* data, size_t len) { out.append(data, len); }
+        void put(char c) { out.push_back(c); }
+        void reserve(size_t len) { out.reserve(out.size() + len); }
+
+        using Writer::write;
+    };
+
+    class StreamWriter : public Writer {
+        std::ostream& out;
+
+    public:
+        explicit StreamWriter(std::ostream& stream) : out(stream) {}
+
+        void write(const char* data, size_t len) { out.write(data, static_cast<std::streamsize>(len)); }
+        void put(char c) { out.put(c); }
+
+        using Writer::write;
+    };
+
+    // Discards the output and only counts it, to size a buffer before writing for real.
+    class CountingWriter : public Writer {
+        size_t len;
+
+    public:
+        CountingWriter() : len(0) {}
+
+        void write(const char*, size_t n) { len += n; }
+        void put(char) { ++len; }
+
+        size_t size() const { return len; }
+
+        using Writer::write;
+    };
+
+    // Writes into a fixed caller-owned span. Output past the end is dropped, but size() keeps
+    // counting, so a caller can detect truncation and retry with a buffer of exactly size() bytes.
+    class BufferWriter : public Writer {
+        char* buf;
+        size_t cap;
+        size_t len;
+
+    public:
+        BufferWriter(char* buffer, size_t capacity) : buf(buffer), cap(capacity), len(0) {}
+
+        void write(const char* data, size_t n) {
+            if (len < cap) std::memcpy(buf + len, data, std::min(n, cap - len));
+            len += n;
+        }
+
+        void put(char c) {
+            if (len < cap) buf[len] = c;
+            ++len;
+        }
+
+        size_t size() const { return len; }
+        bool overflowed() const { return len > cap; }
+
+        using Writer::write;
+    };
+
+    namespace detail {
+        // Like find_escape_special(), but also stops at non-ASCII bytes.
+        inline const char* find_ascii_special(const char* p, const char* end) {
+            for (; p != end; ++p) {
+                unsigned char c = static_cast<unsigned char>(*p);
+                if (c < 0x20 || c >= 0x80 || c == '"' || c == '\\' || c == '/') break;
+            }
+            return p;
+        }
+
+        inline void write_u_escape(uint32_t unit, Writer& out) {
+            static const char hex[] = "0123456789abcdef";
+            char esc[6] = {'\\', 'u', hex[(unit >> 12) & 0xF], hex[(unit >> 8) & 0xF], hex[(unit >> 4) & 0xF],
+                           hex[unit & 0xF]};
+            out.write(esc, 6);
+        }
+
+        // Writes the non-ASCII character at p as \u escapes and steps over it.
+        inline void escape_non_ascii(const char*& p, const char* end, Writer& out) {
+            uint32_t cp = decode_utf8(p, end);
+            if (cp == invalid_utf8) {
+                write_u_escape(0xFFFD, out);
+                ++p;
+            } else if (cp < 0x10000) {
+                write_u_escape(cp, out);
+            } else {
+                write_u_escape(0xD800 + ((cp - 0x10000) >> 10), out);
+                write_u_escape(0xDC00 + ((cp - 0x10000) & 0x3FF), out);
+            }
+        }
+    }
+
+    // Writes the escaped form of [data, data + len) to out. Clean runs are copied in bulk; embedded
+    // NUL bytes are escaped like any other control character. With format().ascii set, non-ASCII
+    // characters are escaped too.
+    inline void escape_str(const char* data, size_t len, Writer& out) {
+        static const char hex[] = "0123456789abcdef";
+
+        const char* p = data;
+        const char* end = data + len;
+        bool ascii = out.format().ascii;
+        out.reserve(len + 2);
+
+        while (p != end) {
+            const char* run = p;
+            p = ascii ? detail::find_ascii_special(p, end) : detail::find_escape_special(p, end);
+            if (p != run) out.write(run, p - run);
+            if (p == end) break;
+            if (static_cast<unsigned char>(*p) >= 0x80) {
+                detail::escape_non_ascii(p, end, out);
+                continue;
+            }
+
+            char esc[6] = {'\\', *p, 0, 0, 0, 0};
+            size_t n = 2;
+            switch (*p) {
+                case '"':
+                case '\\':
+                case '/':
+                    break;
+                case '\b': esc[1] = 'b'; break;
+                case '\f': esc[1] = 'f'; break;
+                case '\n': esc[1] = 'n'; break;
+                case '\r': esc[1] = 'r'; break;
+                case '\t': esc[1] = 't'; break;
+                default:
+                    esc[1] = 'u';
+                    esc[2] = '0';
+                    esc[3] = '0';
+                    esc[4] = hex[(*p >> 4) & 0xF];
+                    esc[5] = hex[*p & 0xF];
+                    n = 6;
+                    break;
+            }
+            out.write(esc, n);
+            ++p;
+        }
+    }
+
+    // Length of the escaped form escape_str() writes for [data, data + len), in ascii form if asked.
+    inline size_t escaped_size(const char* data, size_t len, bool ascii = false) {
+        const char* p = data;
+        const char* end = data + len;
+        size_t n = len;
+
+        while ((p = ascii ? detail::find_ascii_special(p, end) : detail::find_escape_special(p, end)) != end) {
+            unsigned char c = static_cast<unsigned char>(*p);
+            if (c >= 0x80) {
+                const char* start = p;
+                uint32_t cp = detail::decode_utf8(p, end);
+                if (cp == detail::invalid_utf8) ++p;
+                n += (cp != detail::invalid_utf8 && cp >= 0x10000 ? 12 : 6) - static_cast<size_t>(p - start);
+                continue;
+            }
+            ++p;
+            n += c < 0x20 && c != '\b' && c != '\f' && c != '\n' && c != '\r' && c != '\t' ? 5 : 1;
+        }
+        return n;
+    }
+
+    inline void escape_str(const char* data, size_t len, std::string& out) {
+        StringWriter writer(out);
+        escape_str(data, len, writer);
+    }
+
+    inline std::string escape_str(const std::string& str) {
+        std::string out;
+        escape_str(str.data(), str.size(), out);
+        return out;
+    }
+
+    inline std::string parse_str(const std::string &str) {
+        std::string out;
+        out.reserve(str.size());
+
+        const char* begin = str.data();
+        const char* end = begin + str.size();
+        const char* p = detail::unescape(begin, end, out, begin);
+        if (p != end) throw parse_error("unescaped quote in string", p - begin);
+        detail::check_utf8(begin, end, begin);
+
+        return out;
+    }
+
+    // Whether [data, data + len) is well-formed UTF-8 (RFC 3629): no overlong forms, surrogates or code
+    // points past U+10FFFF. Runs 32 bytes at a time with AVX2 where available.
+    inline bool valid_utf8(const char* data, size_t len) {
+        return detail::find_invalid_utf8(data, data + len) == data + len;
+    }
+
+    inline bool valid_utf8(const std::string& str) { return valid_utf8(str.data(), str.size()); }
+
+#if defined(JSONPP_INSTRUMENTATION)
+    // Receives events from the library when it is built with JSONPP_INSTRUMENTATION. The installed
+    // hook is shared by all threads, so implementations must be thread-safe; without the macro every
+    // hook site compiles away.
+    class Instrumentation {
+    public:
+        // A direct heap allocation: node storage, container storage, arena blocks or string copies
+        // outside std::string. Nodes recycled from a thread's pool are not heap allocations.
+        virtual void on_allocate(size_t) {}
+
+        // A node was allocated, on the heap or in an arena, by the parser, create(), clone() or user
+        // code. Nodes constructed on the stack or as object keys are not counted.
+        virtual void on_node() {}
+
+        // A document of bytes was parsed successfully; max_depth is its deepest container nesting.
+        virtual void on_parse(size_t /*bytes*/, size_t /*max_depth*/, uint64_t /*nanoseconds*/) {}
+
+        // A value was serialized to bytes of output by to_string().
+        virtual void on_serialize(size_t /*bytes*/, uint64_t /*nanoseconds*/) {}
+
+        virtual ~Instrumentation() {}
+    };
+
+    // Running totals, ready to be exported as metrics.
+    class InstrumentationCounters : public Instrumentation {
+    public:
+        std::atomic<uint64_t> allocations, bytes_allocated, nodes;
+        std::atomic<uint64_t> documents, bytes_parsed, parse_nanoseconds, max_depth;
+        std::atomic<uint64_t> serializations, bytes_serialized, serialize_nanoseconds;
+
+        InstrumentationCounters() { reset(); }
+
+        void reset() {
+            allocations = bytes_allocated = nodes = 0;
+            documents = bytes_parsed = parse_nanoseconds = max_depth = 0;
+            serializations = bytes_serialized = serialize_nanoseconds = 0;
+        }
+
+        void on_allocate(size_t bytes) {
+            allocations.fetch_add(1, std::memory_order_relaxed);
+            bytes_allocated.fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        void on_node() { nodes.fetch_add(1, std::memory_order_relaxed); }
+
+        void on_parse(size_t bytes, size_t depth, uint64_t ns) {
+            documents.fetch_add(1, std::memory_order_relaxed);
+            bytes_parsed.fetch_add(bytes, std::memory_order_relaxed);
+            parse_nanoseconds.fetch_add(ns, std::memory_order_relaxed);
+            uint64_t seen = max_depth.load(std::memory_order_relaxed);
+            while (depth > seen && !max_depth.compare_exchange_weak(seen, depth, std::memory_order_relaxed)) {}
+        }
+
+        void on_serialize(size_t bytes, uint64_t ns) {
+            serializations.fetch_add(1, std::memory_order_relaxed);
+            bytes_serialized.fetch_add(bytes, std::memory_order_relaxed);
+            serialize_nanoseconds.fetch_add(ns, std::memory_order_relaxed);
+        }
+    };
+
+    namespace detail {
+
+        inline std::atomic<Instrumentation*>& instrumentation_hook() {
+            static std::atomic<Instrumentation*> hook(nullptr);
+            return hook;
+        }
+
+        inline uint64_t clock_ns() {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+    }
+
+    // Installs hook (or none, with nullptr) and returns the previous one. hook must outlive its use.
+    inline Instrumentation* set_instrumentation(Instrumentation* hook) {
+        return detail::instrumentation_hook().exchange(hook);
+    }
+
+#  define JSONPP_INSTRUMENT(event) \
+    do { \
+        if (::jsonpp::Instrumentation* jsonpp_hook_ = ::jsonpp::detail::instrumentation_hook().load(std::memory_order_acquire)) \
+            jsonpp_hook_->event; \
+    } while (0)
+#  define JSONPP_INSTRUMENT_START(var) const uint64_t var = ::jsonpp::detail::clock_ns()
+#  define JSONPP_INSTRUMENT_ELAPSED(var) (::jsonpp::detail::clock_ns() - var)
+#else
+#  define JSONPP_INSTRUMENT(event) ((void)0)
+#  define JSONPP_INSTRUMENT_START(var) ((void)0)
+#endif
+
+    // Bump-pointer allocator. Memory is handed out from large blocks and only released all at once,
+    // by reset() or destruction; individual deallocation is a no-op.
+    class Arena {
+        struct Block {
+            Block* next;
+            size_t size;
+        };
+
+        Block* head;
+        char* cur;
+        char* limit;
+        size_t block_size;
+
+        static const size_t max_block_size = 1 << 20;
+
+        Arena(const Arena&);
+        Arena& operator=(const Arena&);
+
+        void grow(size_t n, size_t align) {
+            size_t need = n + align + sizeof(Block);
+            size_t size = std::max(block_size, need);
+            if (block_size < max_block_size) block_size *= 2;
+
+            Block* block = static_cast<Block*>(::operator new(size));
+            JSONPP_INSTRUMENT(on_allocate(size));
+            block->next = head;
+            block->size = size;
+            head = block;
+            cur = reinterpret_cast<char*>(block + 1);
+            limit = reinterpret_cast<char*>(block) + size;
+        }
+
+    public:
+        explicit Arena(size_t initial_block_size = 4096)
+                : head(nullptr), cur(nullptr), limit(nullptr), block_size(std::max<size_t>(initial_block_size, 64)) {}
+
+        void* allocate(size_t n, size_t align = alignof(std::max_align_t)) {
+            uintptr_t addr = (reinterpret_cast<uintptr_t>(cur) + (align - 1)) & ~static_cast<uintptr_t>(align - 1);
+            if (!cur || addr + n > reinterpret_cast<uintptr_t>(limit)) {
+                grow(n, align);
+                addr = (reinterpret_cast<uintptr_t>(cur) + (align - 1)) & ~static_cast<uintptr_t>(align - 1);
+            }
+            cur = reinterpret_cast<char*>(addr + n);
+            return reinterpret_cast<void*>(addr);
+        }
+
+        // Releases everything but the most recent (and largest) block, which is kept for reuse.
+        void reset() {
+            if (!head) return;
+
+            Block* keep = head;
+            for (Block* b = head->next; b;) {
+                Block* next = b->next;
+                ::operator delete(b);
+                b = next;
+            }
+            keep->next = nullptr;
+            cur = reinterpret_cast<char*>(keep + 1);
+            limit = reinterpret_cast<char*>(keep) + keep->size;
+        }
+
+        ~Arena() {
+            for (Block* b = head; b;) {
+                Block* next = b->next;
+                ::operator delete(b);
+                b = next;
+            }
+        }
+    };
+
+    // Standard allocator over an optional Arena. Without an arena it falls back to the global heap,
+    // which lets the same container types serve both heap-owned and Document-owned trees.
+    template <typename T>
+    class ArenaAllocator {
+        template <typename U> friend class ArenaAllocator;
+
+        Arena* owner;
+
+    public:
+        typedef T value_type;
+        typedef std::true_type propagate_on_container_copy_assignment;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        template <typename U>
+        struct rebind { typedef ArenaAllocator<U> other; };
+
+        ArenaAllocator(Arena* arena = nullptr) : owner(arena) {}
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& that) : owner(that.owner) {}
+
+        Arena* arena() const { return owner; }
+
+        T* allocate(size_t n) {
+            if (owner) return static_cast<T*>(owner->allocate(n * sizeof(T), alignof(T)));
+            JSONPP_INSTRUMENT(on_allocate(n * sizeof(T)));
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+
+        void deallocate(T* ptr, size_t) {
+            if (!owner) ::operator delete(ptr);
+        }
+
+        // Containers must not outlive or escape their arena, so copies are heap-backed.
+        ArenaAllocator select_on_container_copy_construction() const { return ArenaAllocator(); }
+
+        template <typename U>
+        bool operator==(const ArenaAllocator<U>& that) const { return owner == that.owner; }
+
+        template <typename U>
+        bool operator!=(const ArenaAllocator<U>& that) const { return owner != that.owner; }
+    };
+
+    enum class ValueType {
+        NULL_TYPE,
+        BOOLEAN,
+        NUMBER,
+        STRING,
+        ARRAY,
+        OBJECT
+    };
+
+    class JSONValue;
+
+    namespace detail {
+        inline void destroy_children(JSONValue* node);
+        inline size_t measure(const JSONValue& node, const Format& format, size_t level);
+        inline JSONValue* share(const JSONValue& node);
+        inline bool unref(JSONValue* node);
+        inline void mark_borrowing(JSONValue* node);
+        inline void mark_frozen(JSONValue* node);
+
+        // Punctuation and whitespace a Writer emits around members members of a container at level.
+        inline size_t layout_size(const Format& format, size_t level, size_t members, bool object) {
+            size_t n = 2;
+            if (!members) return n;
+
+            n += members - 1;
+            if (object) n += members * (format.indent || format.spaced ? 2 : 1);
+            if (format.indent) n += members * (1 + (level + 1) * format.indent) + 1 + level * format.indent;
+            else if (format.spaced) n += members - 1;
+            return n;
+        }
+
+        // Allocates a node on the heap, or inside arena when one is given.
+        template <typename T, typename... Args>
+        T* make(Arena* arena, Args&&... args) {
+            if (!arena) return new T(std::forward<Args>(args)...);
+            JSONPP_INSTRUMENT(on_node());
+            return ::new (arena->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+    }
+
+    class JSONValue {
+        // Parents holding this node. Heap containers are shared between copies of their parent until
+        // one side changes them, so clone() does not copy whole subtrees.
+        mutable std::atomic<uint32_t> refs;
+
+        // Set by the parser on containers whose strings point into storage the tree does not own (see
+        // ParseOptions::borrow_strings and key_pool). Their copies materialize those strings instead.
+        bool borrowing;
+
+        // Set by freeze(). Frozen containers refuse every change, and their copies start out unfrozen.
+        bool immutable;
+
+        friend bool detail::unref(JSONValue* node);
+        friend void detail::mark_borrowing(JSONValue* node);
+        friend void detail::mark_frozen(JSONValue* node);
+
+    protected:
+        JSONValue() noexcept : refs(1), borrowing(false), immutable(false) {}
+        JSONValue(const JSONValue&) noexcept : refs(1), borrowing(false), immutable(false) {}
+        JSONValue& operator=(const JSONValue&) noexcept { return *this; }
+
+        // Containers implement share() with this: they hand out themselves with one more reference,
+        // unless they live in an arena or borrow storage, in which case they are copied.
+        JSONValue* share_container(bool arena_backed) const {
+            if (arena_backed || borrowing) return clone();
+            refs.fetch_add(1, std::memory_order_relaxed);
+            return const_cast<JSONValue*>(this);
+        }
+
+        // Whether a move may empty this node. Moves out of a frozen or shared container are refused.
+        bool movable() const { return !immutable && !shared(); }
+
+        // Containers refuse to change in place while frozen, or while another tree still refers to them.
+        void require_mutable() const {
+            if (immutable) throw std::logic_error("jsonpp: node is frozen");
+            if (shared()) throw std::logic_error("jsonpp: node is shared; modify it through its parent's operator[]");
+        }
+
+        // Moves owned children into out and leaves this node empty, so that containers can tear
+        // down arbitrarily deep trees iteratively instead of recursing through destructors.
+        virtual void release_children(std::vector<JSONValue*>&) {}
+
+        friend void detail::destroy_children(JSONValue* node);
+
+        // A node standing for this one under a second parent; by default a copy.
+        virtual JSONValue* share() const { return clone(); }
+
+        friend JSONValue* detail::share(const JSONValue& node);
+
+        // Exact length of serialize()'s output in format, starting level containers deep. Node types
+        // compute it directly; the fallback serializes into a CountingWriter.
+        virtual size_t measure(const Format& format, size_t level) const {
+            CountingWriter counter;
+            counter.set_format(format, level);
+            serialize(counter);
+            return counter.size();
+        }
+
+        friend size_t detail::measure(const JSONValue& node, const Format& format, size_t level);
+
+    public:
+        virtual ValueType type() const = 0;
+        virtual void serialize(Writer& out) const = 0;
+
+        // Exact length of the output serialize() produces in format.
+        size_t serialized_size(const Format& format = Format()) const { return measure(format, 0); }
+
+        // Serializes in one pass. To write into a buffer allocated once at its final size, take
+        // serialized_size() and serialize() into a BufferWriter of exactly that capacity.
+        std::string to_string(const Format& format = Format()) const {
+            JSONPP_INSTRUMENT_START(started);
+            std::string out;
+            StringWriter writer(out);
+            writer.set_format(format);
+            serialize(writer);
+            JSONPP_INSTRUMENT(on_serialize(out.size(), JSONPP_INSTRUMENT_ELAPSED(started)));
+            return out;
+        }
+
+        virtual JSONValue* create() const = 0;
+
+        // Copies this node. A heap container's copy shares its child containers with the original, so
+        // this costs one step per direct child; shared children are copied only when changed.
+        virtual JSONValue* clone() const = 0;
+
+        // Whether other trees also hold this node, in which case it must be treated as read-only.
+        bool shared() const { return refs.load(std::memory_order_acquire) > 1; }
+
+        bool frozen() const { return immutable; }
+
+        virtual ~JSONValue() {}
+    };
+
+    namespace detail {
+
+        inline size_t measure(const JSONValue& node, const Format& format, size_t level) {
+            return node.measure(format, level);
+        }
+
+        inline JSONValue* share(const JSONValue& node) { return node.share(); }
+
+        inline void mark_borrowing(JSONValue* node) { node->borrowing = true; }
+
+        inline void mark_frozen(JSONValue* node) { node->immutable = true; }
+
+        // Drops one reference to node and reports whether it was the last.
+        inline bool unref(JSONValue* node) {
+            return node->refs.load(std::memory_order_acquire) == 1 || node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        }
+
+        // Lets go of a heap node that a container held, deleting it unless other trees still share it.
+        inline void release(JSONValue* node) {
+            if (unref(node)) delete node;
+        }
+
+        // Makes slot the only, writable reference to its node, replacing a shared or frozen node with a
+        // private copy. Only for heap containers.
+        inline JSONValue* unshare(JSONValue*& slot) {
+            if (slot->shared() || slot->frozen()) {
+                JSONValue* copy = slot->clone();
+                release(slot);
+                slot = copy;
+            }
+            return slot;
+        }
+
+        inline void destroy_children(JSONValue* node) {
+            std::vector<JSONValue*> pending;
+            node->release_children(pending);
+
+            while (!pending.empty()) {
+                JSONValue* child = pending.back();
+                pending.pop_back();
+                if (!unref(child)) continue;
+                child->release_children(pending);
+                delete child;
+            }
+        }
+
+    }
+
+    // Owning handle for a node that is not (or no longer) in a container.
+    typedef std::unique_ptr<JSONValue> NodePtr;
+
+#ifndef JSONPP_NODE_POOL_LIMIT
+#define JSONPP_NODE_POOL_LIMIT 4096
+#endif
+
+    namespace detail {
+
+        // Per-thread cache of freed heap blocks for one node type, so that documents under constant
+        // mutation recycle nodes instead of going back to the global allocator. Each block is still an
+        // independent global allocation, so a node may be freed on a different thread than the one
+        // that created it. Arena nodes are placed with ::new and never pass through here.
+        template <typename T>
+        class NodePool {
+            struct Block {
+                Block* next;
+            };
+
+            // Trivially destructible, so it stays usable while other thread_local objects are torn down.
+            struct State {
+                Block* head;
+                size_t count;
+                bool armed;
+                bool closed;
+            };
+
+            struct Drain {
+                ~Drain() {
+                    State& s = state();
+                    release(s);
+                    s.closed = true;
+                }
+            };
+
+            static State& state() {
+                static thread_local State s;
+                return s;
+            }
+
+            static void release(State& s) {
+                while (s.head) {
+                    Block* block = s.head;
+                    s.head = block->next;
+                    ::operator delete(block);
+                }
+                s.count = 0;
+            }
+
+        public:
+            static void* allocate(size_t size) {
+                State& s = state();
+                if (size != sizeof(T) || !s.head) {
+                    JSONPP_INSTRUMENT(on_allocate(size));
+                    return ::operator new(size);
+                }
+                Block* block = s.head;
+                s.head = block->next;
+                s.count--;
+                return block;
+            }
+
+            static void deallocate(void* ptr, size_t size) {
+                State& s = state();
+                if (size != sizeof(T) || s.closed || s.count >= JSONPP_NODE_POOL_LIMIT) {
+                    ::operator delete(ptr);
+                    return;
+                }
+                if (!s.armed) {
+                    s.armed = true;
+                    static thread_local Drain drain;
+                    (void)drain;
+                }
+                Block* block = static_cast<Block*>(ptr);
+                block->next = s.head;
+                s.head = block;
+                s.count++;
+            }
+
+            // Returns this thread's cached blocks to the global allocator.
+            static void trim() { release(state()); }
+        };
+
+        // Routes heap new/delete of T through its NodePool. Define JSONPP_NO_NODE_POOL to use the
+        // global allocator directly (e.g. under a leak checker or sanitizer).
+        template <typename T>
+        struct Pooled {
+#if !defined(JSONPP_NO_NODE_POOL)
+            static void* operator new(size_t size) {
+                JSONPP_INSTRUMENT(on_node());
+                return NodePool<T>::allocate(size);
+            }
+
+            static void operator delete(void* ptr, size_t size) { NodePool<T>::deallocate(ptr, size); }
+#elif defined(JSONPP_INSTRUMENTATION)
+            static void* operator new(size_t size) {
+                JSONPP_INSTRUMENT(on_node());
+                JSONPP_INSTRUMENT(on_allocate(size));
+                return ::operator new(size);
+            }
+
+            static void operator delete(void* ptr) { ::operator delete(ptr); }
+#endif
+        };
+
+    }
+
+    inline JSONValue* clone(const JSONValue* that) {
+        return that->clone();
+    }
+
+    class JSONNullType : public JSONValue, public detail::Pooled<JSONNullType> {
+    public:
+        JSONNullType() : JSONValue() {}
+        ValueType type() const { return ValueType::NULL_TYPE; }
+        void serialize(Writer& out) const { out.write("null", 4); }
+
+        JSONNullType* create() const {
+            return new JSONNullType();
+        }
+
+        JSONNullType* clone() const {
+            return new JSONNullType();
+        }
+
+    protected:
+        size_t measure(const Format&, size_t) const { return 4; }
+    };
+
+    class JSONBooleanType : public JSONValue, public detail::Pooled<JSONBooleanType> {
+
+        bool value;
+
+    public:
+        JSONBooleanType(bool type) : JSONValue(), value(type) {}
+        JSONBooleanType() : JSONValue(), value(false) {}
+
+        bool get() const { return value; }
+
+        ValueType type() const { return ValueType::BOOLEAN; }
+
+        void serialize(Writer& out) const {
+            if (value) out.write("true", 4);
+            else out.write("false", 5);
+        }
+
+        JSONBooleanType* create() const {
+            return new JSONBooleanType();
+        }
+
+        JSONBooleanType* clone() const {
+            return new JSONBooleanType(*this);
+        }
+
+    protected:
+        size_t measure(const Format&, size_t) const { return value ? 4 : 5; }
+    };
+
+    namespace detail {
+
+        // Containers never hold a null pointer; a missing node is stored as JSON null.
+        inline JSONValue* or_null(JSONValue* node, Arena* arena) { return node ? node : make<JSONNullType>(arena); }
+
+        // A node taken out of an arena-backed container cannot be freed on its own, so it leaves as a copy.
+        inline NodePtr adopt(JSONValue* node, Arena* arena) { return NodePtr(arena ? node->clone() : node); }
+
+    }
+
+    class JSONArray : public JSONValue, public detail::Pooled<JSONArray> {
+
+        std::vector<JSONValue*, ArenaAllocator<JSONValue*> > values;
+
+        void swap(JSONArray& that) {
+            require_mutable();
+            that.require_mutable();
+            std::swap(this->values, that.values);
+        }
+
+    protected:
+        void release_children(std::vector<JSONValue*>& out) {
+            out.insert(out.end(), values.begin(), values.end());
+            values.clear();
+        }
+
+        size_t measure(const Format& format, size_t level) const {
+            size_t n = detail::layout_size(format, level, values.size(), false);
+            for (const JSONValue* value : values) n += detail::measure(*value, format, level + 1);
+            return n;
+        }
+
+        JSONValue* share() const { return share_container(arena() != nullptr); }
+
+    public:
+        JSONArray() : JSONValue() {}
+
+        // An arena-backed array keeps its storage in arena, and its elements are expected to live there too.
+        explicit JSONArray(Arena* arena) : JSONValue(), values(ArenaAllocator<JSONValue*>(arena)) {}
+
+        // Takes ownership of the nodes in [begin, end); like push_back(), stores null pointers as JSON null.
+        template <typename InputIterator>
+        JSONArray(InputIterator begin, InputIterator end) : JSONValue() {
+            for (; begin != end; ++begin) values.push_back(detail::or_null(*begin, nullptr));
+        }
+
+        // A copy of a heap array shares nested containers with that; a copy of an arena array is deep.
+        JSONArray(const JSONArray& that) : JSONValue() {
+            values.reserve(that.size());
+            for (const JSONValue* value : that.values) values.push_back(that.arena() ? value->clone() : detail::share(*value));
+        }
+
+        // Takes over the elements (and arena, if any) of that, leaving it empty. A move never allocates:
+        // from a frozen or shared that, whose other owners still see it, it is refused up front, leaving
+        // that as it is and this empty. Copy such an array instead.
+        JSONArray(JSONArray&& that) noexcept : JSONValue() {
+            if (that.movable()) values.swap(that.values);
+        }
+
+        // Elements are observed through iterators and operator[]; the array keeps ownership, so slots
+        // can only be changed through set(), take() and erase(). Elements reached by iteration or the
+        // const operator[] may be shared with copies of this array and must not be modified.
+        typedef std::vector<JSONValue*, ArenaAllocator<JSONValue*> >::const_iterator iterator;
+        typedef iterator const_iterator;
+
+        const_iterator begin() const { return values.begin(); }
+        const_iterator end() const { return values.end(); }
+
+        const JSONValue* operator[](size_t index) const { return values[index]; }
+
+        // An element that may be modified: if it is shared, it is first replaced by a private copy.
+        JSONValue* operator[](size_t index) {
+            require_mutable();
+            return arena() ? values[index] : detail::unshare(values[index]);
+        }
+
+        size_t size() const {return values.size(); }
+
+        // Takes ownership of value; a null pointer is stored as JSON null.
+        void push_back(JSONValue* value) {
+            require_mutable();
+            values.push_back(detail::or_null(value, arena()));
+        }
+
+        template <typename T>
+        void push_back(std::unique_ptr<T> value) { push_back(static_cast<JSONValue*>(value.release())); }
+
+        // Replaces an element, deleting the old one. Setting an element to itself changes nothing.
+        void set(size_t index, JSONValue* value) {
+            require_mutable();
+            JSONValue* old = values[index];
+            if (value == old) return;
+            values[index] = detail::or_null(value, arena());
+            if (!arena()) detail::release(old);
+        }
+
+        template <typename T>
+        void set(size_t index, std::unique_ptr<T> value) { set(index, static_cast<JSONValue*>(value.release())); }
+
+        // Removes an element and hands it to the caller.
+        NodePtr take(size_t index) {
+            require_mutable();
+            JSONValue* node = values[index];
+            if (!arena()) detail::unshare(node);
+            values.erase(values.begin() + index);
+            return detail::adopt(node, arena());
+        }
+
+        void erase(size_t index) {
+            require_mutable();
+            JSONValue* node = values[index];
+            values.erase(values.begin() + index);
+            if (!arena()) detail::release(node);
+        }
+
+        // Appends node by moving (or copying) it into a new element allocated where the array's storage is.
+        template <typename T, typename = typename std::enable_if<std::is_base_of<JSONValue, typename std::decay<T>::type>::value>::type>
+        void push_back(T&& node) {
+            require_mutable();
+            values.push_back(detail::make<typename std::decay<T>::type>(arena(), std::forward<T>(node)));
+        }
+
+        // Constructs a new element in place and returns it. In an arena-backed array, pass the arena to
+        // nodes that have storage of their own, as with Document::make.
+        template <typename T, typename... Args>
+        T* emplace_back(Args&&... args) {
+            require_mutable();
+            T* node = detail::make<T>(arena(), std::forward<Args>(args)...);
+            values.push_back(node);
+            return node;
+        }
+
+        JSONArray& operator=(const JSONArray& that) {
+            require_mutable();
+            JSONArray copy(that);
+            swap(copy);
+            return *this;
+        }
+
+        // The previous elements are released before returning; that is left empty. Throws logic_error,
+        // changing neither side, if either is frozen or shared.
+        JSONArray& operator=(JSONArray&& that) {
+            require_mutable();
+            that.require_mutable();
+            JSONArray old(std::move(that));
+            swap(old);
+            return *this;
+        }
+
+        JSONArray* create() const {
+            return new JSONArray();
+        }
+
+        JSONArray* clone() const {
+            return new JSONArray(*this);
+        }
+
+        Arena* arena() const { return values.get_allocator().arena(); }
+
+        ValueType type() const { return ValueType::ARRAY; }
+
+        ~JSONArray() {
+            if (!arena()) detail::destroy_children(this);
+        }
+
+        void serialize(Writer& out) const {
+            out.open('[');
+
+            for (const_iterator it = values.begin(); it != values.end(); ++it) {
+                out.separator(it == values.begin());
+                (*it)->serialize(out);
+            }
+
+            out.close(']', values.empty());
+        }
+
+    };
+
+    class JSONString : public JSONValue, public detail::Pooled<JSONString> {
+        std::string value;
+
+        // When set, the string borrows [ref, ref + ref_len) instead of owning value.
+        const char* ref;
+        size_t ref_len;
+
+    public:
+        JSONString() : JSONValue(), ref(nullptr), ref_len(0) {}
+        JSONString(const JSONString& that) : JSONValue(), value(that.data(), that.size()), ref(nullptr), ref_len(0) {}
+
+        // Moves keep borrowed strings borrowed; only copies materialize them.
+        JSONString(JSONString&& that) noexcept : JSONValue(), value(std::move(that.value)), ref(that.ref), ref_len(that.ref_len) {
+            that.ref = nullptr;
+            that.ref_len = 0;
+        }
+
+        JSONString(std::string&& str) : JSONValue(), value(std::move(str)), ref(nullptr), ref_len(0) {}
+
+        JSONString(const std::string& str, bool parse=false) : JSONValue(), ref(nullptr), ref_len(0) {
+            if (!parse) {
+                value = std::string(str);
+            } else {
+                value = jsonpp::parse_str(str);
+            }
+        }
+
+        // Copies [str, str + len). With an arena the bytes are placed in it and the string borrows them.
+        JSONString(const char* str, size_t len, Arena* arena = nullptr) : JSONValue(), ref(nullptr), ref_len(0) {
+            if (!arena) {
+                value.assign(str, len);
+            } else {
+                char* copy = static_cast<char*>(arena->allocate(len ? len : 1, 1));
+                std::memcpy(copy, str, len);
+                ref = copy;
+                ref_len = len;
+            }
+        }
+
+        // A string that refers to [str, str + len) without copying it; the bytes must outlive it.
+        static JSONString view(const char* str, size_t len) {
+            JSONString out;
+            out.ref = len ? str : "";
+            out.ref_len = len;
+            return out;
+        }
+
+        const char* data() const { return ref ? ref : value.data(); }
+        size_t size() const { return ref ? ref_len : value.size(); }
+
+        operator std::string() const {
+            return std::string(data(), size());
+        }
+
+        ValueType type() const { return ValueType::STRING; }
+
+        JSONString& operator=(const JSONString& that) { return *this = JSONString(that); }
+
+        JSONString& operator=(JSONString&& that) noexcept {
+            value = std::move(that.value);
+            ref = that.ref;
+            ref_len = that.ref_len;
+            that.ref = nullptr;
+            that.ref_len = 0;
+            return *this;
+        }
+
+        int compare(const JSONString& that) const {
+            size_t n = std::min(size(), that.size());
+            int c = n ? std::memcmp(data(), that.data(), n) : 0;
+            if (c != 0) return c;
+            return size() < that.size() ? -1 : (size() > that.size() ? 1 : 0);
+        }
+
+        bool operator<(const JSONString& that) const { return compare(that) < 0; }
+        bool operator==(const JSONString& that) const {
+            return size() == that.size() && (size() == 0 || std::memcmp(data(), that.data(), size()) == 0);
+        }
+
+        void serialize(Writer& out) const {
+            out.put('"');
+            jsonpp::escape_str(data(), size(), out);
+            out.put('"');
+        }
+
+        JSONString* create() const {
+            return new JSONString();
+        }
+
+        JSONString* clone() const {
+            return new JSONString(*this);
+        }
+
+    protected:
+        size_t measure(const Format& format, size_t) const { return escaped_size(data(), size(), format.ascii) + 2; }
+    };
+
+    enum class NumberType {
+        FLOAT,
+        INTEGER
+    };
+
+    namespace detail {
+
+        inline unsigned clz64(uint64_t x) {
+#if defined(_MSC_VER) && defined(_M_X64)
+            unsigned long i;
+            _BitScanReverse64(&i, x);
+            return 63 - static_cast<unsigned>(i);
+#elif defined(_MSC_VER)
+            unsigned long i;
+            if (x >> 32) {
+                _BitScanReverse(&i, static_cast<unsigned long>(x >> 32));
+                return 31 - static_cast<unsigned>(i);
+            }
+            _BitScanReverse(&i, static_cast<unsigned long>(x));
+            return 63 - static_cast<unsigned>(i);
+#else
+            return static_cast<unsigned>(__builtin_clzll(x));
+#endif
+        }
+
+        inline void mul128(uint64_t a, uint64_t b, uint64_t& hi, uint64_t& lo) {
+#if defined(__SIZEOF_INT128__)
+            unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+            hi = static_cast<uint64_t>(r >> 64);
+            lo = static_cast<uint64_t>(r);
+#elif defined(_MSC_VER) && defined(_M_X64)
+            lo = _umul128(a, b, &hi);
+#else
+            uint64_t a_lo = a & 0xFFFFFFFF, a_hi = a >> 32;
+            uint64_t b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+            uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+            uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFF) + (hl & 0xFFFFFFFF);
+            hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+            lo = (mid << 32) | (ll & 0xFFFFFFFF);
+#endif
+        }
+
+        inline double bits_to_double(uint64_t bits) {
+            double d;
+            std::memcpy(&d, &bits, sizeof(d));
+            return d;
+        }
+
+        inline uint64_t double_to_bits(double d) {
+            uint64_t bits;
+            std::memcpy(&bits, &d, sizeof(bits));
+            return bits;
+        }
+
+        inline uint64_t load_u64_le(const char* p) {
+            uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            v = __builtin_bswap64(v);
+#endif
+            return v;
+        }
+
+        // SWAR check that all eight bytes of v are ASCII digits.
+        inline bool is_eight_digits(uint64_t v) {
+            return (((v & 0xF0F0F0F0F0F0F0F0ULL) | (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))
+                    == 0x3333333333333333ULL);
+        }
+
+        // Converts eight ASCII digits (first digit in the low byte) with three multiplications.
+        inline uint32_t parse_eight_digits(uint64_t v) {
+            const uint64_t mask = 0x000000FF000000FFULL;
+            const uint64_t mul1 = 0x000F424000000064ULL;
+            const uint64_t mul2 = 0x0000271000000001ULL;
+            v -= 0x3030303030303030ULL;
+            v = (v * 10) + (v >> 8);
+            v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+            return static_cast<uint32_t>(v);
+        }
+
+        // Truncated 128-bit mantissas of 5^q for q in [-342, 308], as used by the Eisel-Lemire algorithm.
+        inline const uint64_t* power_of_five_128() {
+            static const uint64_t table[] = {
+                    0xeef453d6923bd65a,0x113faa2906a13b3f, 0x9558b4661b6565f8,0x4ac7ca59a424c507,
+                    0xbaaee17fa23ebf76,0x5d79bcf00d2df649, 0xe95a99df8ace6f53,0xf4d82c2c107973dc,
+                    0x91d8a02bb6c10594,0x79071b9b8a4be869, 0xb64ec836a47146f9,0x9748e2826cdee284,
+                    0xe3e27a444d8d98b7,0xfd1b1b2308169b25, 0x8e6d8c6ab0787f72,0xfe30f0f5e50e20f7,
+                    0xb208ef855c969f4f,0xbdbd2d335e51a935, 0xde8b2b66b3bc4723,0xad2c788035e61382,
+                    0x8b16fb203055ac76,0x4c3bcb5021afcc31, 0xaddcb9e83c6b1793,0xdf4abe242a1bbf3d,
+                    0xd953e8624b85dd78,0xd71d6dad34a2af0d, 0x87d4713d6f33aa6b,0x8672648c40e5ad68,
+                    0xa9c98d8ccb009506,0x680efdaf511f18c2, 0xd43bf0effdc0ba48,0x0212bd1b2566def2,
+                    0x84a57695fe98746d,0x014bb630f7604b57, 0xa5ced43b7e3e9188,0x419ea3bd35385e2d,
+                    0xcf42894a5dce35ea,0x52064cac828675b9, 0x818995ce7aa0e1b2,0x7343efebd1940993,
+                    0xa1ebfb4219491a1f,0x1014ebe6c5f90bf8, 0xca66fa129f9b60a6,0xd41a26e077774ef6,
+                    0xfd00b897478238d0,0x8920b098955522b4, 0x9e20735e8cb16382,0x55b46e5f5d5535b0,
+                    0xc5a890362fddbc62,0xeb2189f734aa831d, 0xf712b443bbd52b7b,0xa5e9ec7501d523e4,
+                    0x9a6bb0aa55653b2d,0x47b233c92125366e, 0xc1069cd4eabe89f8,0x999ec0bb696e840a,
+                    0xf148440a256e2c76,0xc00670ea43ca250d, 0x96cd2a865764dbca,0x380406926a5e5728,
+                    0xbc807527ed3e12bc,0xc605083704f5ecf2, 0xeba09271e88d976b,0xf7864a44c633682e,
+                    0x93445b8731587ea3,0x7ab3ee6afbe0211d, 0xb8157268fdae9e4c,0x5960ea05bad82964,
+                    0xe61acf033d1a45df,0x6fb92487298e33bd, 0x8fd0c16206306bab,0xa5d3b6d479f8e056,
+                    0xb3c4f1ba87bc8696,0x8f48a4899877186c, 0xe0b62e2929aba83c,0x331acdabfe94de87,
+                    0x8c71dcd9ba0b4925,0x9ff0c08b7f1d0b14, 0xaf8e5410288e1b6f,0x07ecf0ae5ee44dd9,
+                    0xdb71e91432b1a24a,0xc9e82cd9f69d6150, 0x892731ac9faf056e,0xbe311c083a225cd2,
+                    0xab70fe17c79ac6ca,0x6dbd630a48aaf406, 0xd64d3d9db981787d,0x092cbbccdad5b108,
+                    0x85f0468293f0eb4e,0x25bbf56008c58ea5, 0xa76c582338ed2621,0xaf2af2b80af6f24e,
+                    0xd1476e2c07286faa,0x1af5af660db4aee1, 0x82cca4db847945ca,0x50d98d9fc890ed4d,
+                    0xa37fce126597973c,0xe50ff107bab528a0, 0xcc5fc196fefd7d0c,0x1e53ed49a96272c8,
+                    0xff77b1fcbebcdc4f,0x25e8e89c13bb0f7a, 0x9faacf3df73609b1,0x77b191618c54e9ac,
+                    0xc795830d75038c1d,0xd59df5b9ef6a2417, 0xf97ae3d0d2446f25,0x4b0573286b44ad1d,
+                    0x9becce62836ac577,0x4ee367f9430aec32, 0xc2e801fb244576d5,0x229c41f793cda73f,
+                    0xf3a20279ed56d48a,0x6b43527578c1110f, 0x9845418c345644d6,0x830a13896b78aaa9,
+                    0xbe5691ef416bd60c,0x23cc986bc656d553, 0xedec366b11c6cb8f,0x2cbfbe86b7ec8aa8,
+                    0x94b3a202eb1c3f39,0x7bf7d71432f3d6a9, 0xb9e08a83a5e34f07,0xdaf5ccd93fb0cc53,
+                    0xe858ad248f5c22c9,0xd1b3400f8f9cff68, 0x91376c36d99995be,0x23100809b9c21fa1,
+                    0xb58547448ffffb2d,0xabd40a0c2832a78a, 0xe2e69915b3fff9f9,0x16c90c8f323f516c,
+                    0x8dd01fad907ffc3b,0xae3da7d97f6792e3, 0xb1442798f49ffb4a,0x99cd11cfdf41779c,
+                    0xdd95317f31c7fa1d,0x40405643d711d583, 0x8a7d3eef7f1cfc52,0x482835ea666b2572,
+                    0xad1c8eab5ee43b66,0xda3243650005eecf, 0xd863b256369d4a40,0x90bed43e40076a82,
+                    0x873e4f75e2224e68,0x5a7744a6e804a291, 0xa90de3535aaae202,0x711515d0a205cb36,
+                    0xd3515c2831559a83,0x0d5a5b44ca873e03, 0x8412d9991ed58091,0xe858790afe9486c2,
+                    0xa5178fff668ae0b6,0x626e974dbe39a872, 0xce5d73ff402d98e3,0xfb0a3d212dc8128f,
+                    0x80fa687f881c7f8e,0x7ce66634bc9d0b99, 0xa139029f6a239f72,0x1c1fffc1ebc44e80,
+                    0xc987434744ac874e,0xa327ffb266b56220, 0xfbe9141915d7a922,0x4bf1ff9f0062baa8,
+                    0x9d71ac8fada6c9b5,0x6f773fc3603db4a9, 0xc4ce17b399107c22,0xcb550fb4384d21d3,
+                    0xf6019da07f549b2b,0x7e2a53a146606a48, 0x99c102844f94e0fb,0x2eda7444cbfc426d,
+                    0xc0314325637a1939,0xfa911155fefb5308, 0xf03d93eebc589f88,0x793555ab7eba27ca,
+                    0x96267c7535b763b5,0x4bc1558b2f3458de, 0xbbb01b9283253ca2,0x9eb1aaedfb016f16,
+                    0xea9c227723ee8bcb,0x465e15a979c1cadc, 0x92a1958a7675175f,0x0bfacd89ec191ec9,
+                    0xb749faed14125d36,0xcef980ec671f667b, 0xe51c79a85916f484,0x82b7e12780e7401a,
+                    0x8f31cc0937ae58d2,0xd1b2ecb8b0908810, 0xb2fe3f0b8599ef07,0x861fa7e6dcb4aa15,
+                    0xdfbdcece67006ac9,0x67a791e093e1d49a, 0x8bd6a141006042bd,0xe0c8bb2c5c6d24e0,
+                    0xaecc49914078536d,0x58fae9f773886e18, 0xda7f5bf590966848,0xaf39a475506a899e,
+                    0x888f99797a5e012d,0x6d8406c952429603, 0xaab37fd7d8f58178,0xc8e5087ba6d33b83,
+                    0xd5605fcdcf32e1d6,0xfb1e4a9a90880a64, 0x855c3be0a17fcd26,0x5cf2eea09a55067f,
+                    0xa6b34ad8c9dfc06f,0xf42faa48c0ea481e, 0xd0601d8efc57b08b,0xf13b94daf124da26,
+                    0x823c12795db6ce57,0x76c53d08d6b70858, 0xa2cb1717b52481ed,0x54768c4b0c64ca6e,
+                    0xcb7ddcdda26da268,0xa9942f5dcf7dfd09, 0xfe5d54150b090b02,0xd3f93b35435d7c4c,
+                    0x9efa548d26e5a6e1,0xc47bc5014a1a6daf, 0xc6b8e9b0709f109a,0x359ab6419ca1091b,
+                    0xf867241c8cc6d4c0,0xc30163d203c94b62, 0x9b407691d7fc44f8,0x79e0de63425dcf1d,
+                    0xc21094364dfb5636,0x985915fc12f542e4, 0xf294b943e17a2bc4,0x3e6f5b7b17b2939d,
+                    0x979cf3ca6cec5b5a,0xa705992ceecf9c42, 0xbd8430bd08277231,0x50c6ff782a838353,
+                    0xece53cec4a314ebd,0xa4f8bf5635246428, 0x940f4613ae5ed136,0x871b7795e136be99,
+                    0xb913179899f68584,0x28e2557b59846e3f, 0xe757dd7ec07426e5,0x331aeada2fe589cf,
+                    0x9096ea6f3848984f,0x3ff0d2c85def7621, 0xb4bca50b065abe63,0x0fed077a756b53a9,
+                    0xe1ebce4dc7f16dfb,0xd3e8495912c62894, 0x8d3360f09cf6e4bd,0x64712dd7abbbd95c,
+                    0xb080392cc4349dec,0xbd8d794d96aacfb3, 0xdca04777f541c567,0xecf0d7a0fc5583a0,
+                    0x89e42caaf9491b60,0xf41686c49db57244, 0xac5d37d5b79b6239,0x311c2875c522ced5,
+                    0xd77485cb25823ac7,0x7d633293366b828b, 0x86a8d39ef77164bc,0xae5dff9c02033197,
+                    0xa8530886b54dbdeb,0xd9f57f830283fdfc, 0xd267caa862a12d66,0xd072df63c324fd7b,
+                    0x8380dea93da4bc60,0x4247cb9e59f71e6d, 0xa46116538d0deb78,0x52d9be85f074e608,
+                    0xcd795be870516656,0x67902e276c921f8b, 0x806bd9714632dff6,0x00ba1cd8a3db53b6,
+                    0xa086cfcd97bf97f3,0x80e8a40eccd228a4, 0xc8a883c0fdaf7df0,0x6122cd128006b2cd,
+                    0xfad2a4b13d1b5d6c,0x796b805720085f81, 0x9cc3a6eec6311a63,0xcbe3303674053bb0,
+                    0xc3f490aa77bd60fc,0xbedbfc4411068a9c, 0xf4f1b4d515acb93b,0xee92fb5515482d44,
+                    0x991711052d8bf3c5,0x751bdd152d4d1c4a, 0xbf5cd54678eef0b6,0xd262d45a78a0635d,
+                    0xef340a98172aace4,0x86fb897116c87c34, 0x9580869f0e7aac0e,0xd45d35e6ae3d4da0,
+                    0xbae0a846d2195712,0x8974836059cca109, 0xe998d258869facd7,0x2bd1a438703fc94b,
+                    0x91ff83775423cc06,0x7b6306a34627ddcf, 0xb67f6455292cbf08,0x1a3bc84c17b1d542,
+                    0xe41f3d6a7377eeca,0x20caba5f1d9e4a93, 0x8e938662882af53e,0x547eb47b7282ee9c,
+                    0xb23867fb2a35b28d,0xe99e619a4f23aa43, 0xdec681f9f4c31f31,0x6405fa00e2ec94d4,
+                    0x8b3c113c38f9f37e,0xde83bc408dd3dd04, 0xae0b158b4738705e,0x9624ab50b148d445,
+                    0xd98ddaee19068c76,0x3badd624dd9b0957, 0x87f8a8d4cfa417c9,0xe54ca5d70a80e5d6,
+                    0xa9f6d30a038d1dbc,0x5e9fcf4ccd211f4c, 0xd47487cc8470652b,0x7647c3200069671f,
+                    0x84c8d4dfd2c63f3b,0x29ecd9f40041e073, 0xa5fb0a17c777cf09,0xf468107100525890,
+                    0xcf79cc9db955c2cc,0x7182148d4066eeb4, 0x81ac1fe293d599bf,0xc6f14cd848405530,
+                    0xa21727db38cb002f,0xb8ada00e5a506a7c, 0xca9cf1d206fdc03b,0xa6d90811f0e4851c,
+                    0xfd442e4688bd304a,0x908f4a166d1da663, 0x9e4a9cec15763e2e,0x9a598e4e043287fe,
+                    0xc5dd44271ad3cdba,0x40eff1e1853f29fd, 0xf7549530e188c128,0xd12bee59e68ef47c,
+                    0x9a94dd3e8cf578b9,0x82bb74f8301958ce, 0xc13a148e3032d6e7,0xe36a52363c1faf01,
+                    0xf18899b1bc3f8ca1,0xdc44e6c3cb279ac1, 0x96f5600f15a7b7e5,0x29ab103a5ef8c0b9,
+                    0xbcb2b812db11a5de,0x7415d448f6b6f0e7, 0xebdf661791d60f56,0x111b495b3464ad21,
+                    0x936b9fcebb25c995,0xcab10dd900beec34, 0xb84687c269ef3bfb,0x3d5d514f40eea742,
+                    0xe65829b3046b0afa,0x0cb4a5a3112a5112, 0x8ff71a0fe2c2e6dc,0x47f0e785eaba72ab,
+                    0xb3f4e093db73a093,0x59ed216765690f56, 0xe0f218b8d25088b8,0x306869c13ec3532c,
+                    0x8c974f7383725573,0x1e414218c73a13fb, 0xafbd2350644eeacf,0xe5d1929ef90898fa,
+                    0xdbac6c247d62a583,0xdf45f746b74abf39, 0x894bc396ce5da772,0x6b8bba8c328eb783,
+                    0xab9eb47c81f5114f,0x066ea92f3f326564, 0xd686619ba27255a2,0xc80a537b0efefebd,
+                    0x8613fd0145877585,0xbd06742ce95f5f36, 0xa798fc4196e952e7,0x2c48113823b73704,
+                    0xd17f3b51fca3a7a0,0xf75a15862ca504c5, 0x82ef85133de648c4,0x9a984d73dbe722fb,
+                    0xa3ab66580d5fdaf5,0xc13e60d0d2e0ebba, 0xcc963fee10b7d1b3,0x318df905079926a8,
+                    0xffbbcfe994e5c61f,0xfdf17746497f7052, 0x9fd561f1fd0f9bd3,0xfeb6ea8bedefa633,
+                    0xc7caba6e7c5382c8,0xfe64a52ee96b8fc0, 0xf9bd690a1b68637b,0x3dfdce7aa3c673b0,
+                    0x9c1661a651213e2d,0x06bea10ca65c084e, 0xc31bfa0fe5698db8,0x486e494fcff30a62,
+                    0xf3e2f893dec3f126,0x5a89dba3c3efccfa, 0x986ddb5c6b3a76b7,0xf89629465a75e01c,
+                    0xbe89523386091465,0xf6bbb397f1135823, 0xee2ba6c0678b597f,0x746aa07ded582e2c,
+                    0x94db483840b717ef,0xa8c2a44eb4571cdc, 0xba121a4650e4ddeb,0x92f34d62616ce413,
+                    0xe896a0d7e51e1566,0x77b020baf9c81d17, 0x915e2486ef32cd60,0x0ace1474dc1d122e,
+                    0xb5b5ada8aaff80b8,0x0d819992132456ba, 0xe3231912d5bf60e6,0x10e1fff697ed6c69,
+                    0x8df5efabc5979c8f,0xca8d3ffa1ef463c1, 0xb1736b96b6fd83b3,0xbd308ff8a6b17cb2,
+                    0xddd0467c64bce4a0,0xac7cb3f6d05ddbde, 0x8aa22c0dbef60ee4,0x6bcdf07a423aa96b,
+                    0xad4ab7112eb3929d,0x86c16c98d2c953c6, 0xd89d64d57a607744,0xe871c7bf077ba8b7,
+                    0x87625f056c7c4a8b,0x11471cd764ad4972, 0xa93af6c6c79b5d2d,0xd598e40d3dd89bcf,
+                    0xd389b47879823479,0x4aff1d108d4ec2c3, 0x843610cb4bf160cb,0xcedf722a585139ba,
+                    0xa54394fe1eedb8fe,0xc2974eb4ee658828, 0xce947a3da6a9273e,0x733d226229feea32,
+                    0x811ccc668829b887,0x0806357d5a3f525f, 0xa163ff802a3426a8,0xca07c2dcb0cf26f7,
+                    0xc9bcff6034c13052,0xfc89b393dd02f0b5, 0xfc2c3f3841f17c67,0xbbac2078d443ace2,
+                    0x9d9ba7832936edc0,0xd54b944b84aa4c0d, 0xc5029163f384a931,0x0a9e795e65d4df11,
+                    0xf64335bcf065d37d,0x4d4617b5ff4a16d5, 0x99ea0196163fa42e,0x504bced1bf8e4e45,
+                    0xc06481fb9bcf8d39,0xe45ec2862f71e1d6, 0xf07da27a82c37088,0x5d767327bb4e5a4c,
+                    0x964e858c91ba2655,0x3a6a07f8d510f86f, 0xbbe226efb628afea,0x890489f70a55368b,
+                    0xeadab0aba3b2dbe5,0x2b45ac74ccea842e, 0x92c8ae6b464fc96f,0x3b0b8bc90012929d,
+                    0xb77ada0617e3bbcb,0x09ce6ebb40173744, 0xe55990879ddcaabd,0xcc420a6a101d0515,
+                    0x8f57fa54c2a9eab6,0x9fa946824a12232d, 0xb32df8e9f3546564,0x47939822dc96abf9,
+                    0xdff9772470297ebd,0x59787e2b93bc56f7, 0x8bfbea76c619ef36,0x57eb4edb3c55b65a,
+                    0xaefae51477a06b03,0xede622920b6b23f1, 0xdab99e59958885c4,0xe95fab368e45eced,
+                    0x88b402f7fd75539b,0x11dbcb0218ebb414, 0xaae103b5fcd2a881,0xd652bdc29f26a119,
+                    0xd59944a37c0752a2,0x4be76d3346f0495f, 0x857fcae62d8493a5,0x6f70a4400c562ddb,
+                    0xa6dfbd9fb8e5b88e,0xcb4ccd500f6bb952, 0xd097ad07a71f26b2,0x7e2000a41346a7a7,
+                    0x825ecc24c873782f,0x8ed400668c0c28c8, 0xa2f67f2dfa90563b,0x728900802f0f32fa,
+                    0xcbb41ef979346bca,0x4f2b40a03ad2ffb9, 0xfea126b7d78186bc,0xe2f610c84987bfa8,
+                    0x9f24b832e6b0f436,0x0dd9ca7d2df4d7c9, 0xc6ede63fa05d3143,0x91503d1c79720dbb,
+                    0xf8a95fcf88747d94,0x75a44c6397ce912a, 0x9b69dbe1b548ce7c,0xc986afbe3ee11aba,
+                    0xc24452da229b021b,0xfbe85badce996168, 0xf2d56790ab41c2a2,0xfae27299423fb9c3,
+                    0x97c560ba6b0919a5,0xdccd879fc967d41a, 0xbdb6b8e905cb600f,0x5400e987bbc1c920,
+                    0xed246723473e3813,0x290123e9aab23b68, 0x9436c0760c86e30b,0xf9a0b6720aaf6521,
+                    0xb94470938fa89bce,0xf808e40e8d5b3e69, 0xe7958cb87392c2c2,0xb60b1d1230b20e04,
+                    0x90bd77f3483bb9b9,0xb1c6f22b5e6f48c2, 0xb4ecd5f01a4aa828,0x1e38aeb6360b1af3,
+                    0xe2280b6c20dd5232,0x25c6da63c38de1b0, 0x8d590723948a535f,0x579c487e5a38ad0e,
+                    0xb0af48ec79ace837,0x2d835a9df0c6d851, 0xdcdb1b2798182244,0xf8e431456cf88e65,
+                    0x8a08f0f8bf0f156b,0x1b8e9ecb641b58ff, 0xac8b2d36eed2dac5,0xe272467e3d222f3f,
+                    0xd7adf884aa879177,0x5b0ed81dcc6abb0f, 0x86ccbb52ea94baea,0x98e947129fc2b4e9,
+                    0xa87fea27a539e9a5,0x3f2398d747b36224, 0xd29fe4b18e88640e,0x8eec7f0d19a03aad,
+                    0x83a3eeeef9153e89,0x1953cf68300424ac, 0xa48ceaaab75a8e2b,0x5fa8c3423c052dd7,
+                    0xcdb02555653131b6,0x3792f412cb06794d, 0x808e17555f3ebf11,0xe2bbd88bbee40bd0,
+                    0xa0b19d2ab70e6ed6,0x5b6aceaeae9d0ec4, 0xc8de047564d20a8b,0xf245825a5a445275,
+                    0xfb158592be068d2e,0xeed6e2f0f0d56712, 0x9ced737bb6c4183d,0x55464dd69685606b,
+                    0xc428d05aa4751e4c,0xaa97e14c3c26b886, 0xf53304714d9265df,0xd53dd99f4b3066a8,
+                    0x993fe2c6d07b7fab,0xe546a8038efe4029, 0xbf8fdb78849a5f96,0xde98520472bdd033,
+                    0xef73d256a5c0f77c,0x963e66858f6d4440, 0x95a8637627989aad,0xdde7001379a44aa8,
+                    0xbb127c53b17ec159,0x5560c018580d5d52, 0xe9d71b689dde71af,0xaab8f01e6e10b4a6,
+                    0x9226712162ab070d,0xcab3961304ca70e8, 0xb6b00d69bb55c8d1,0x3d607b97c5fd0d22,
+                    0xe45c10c42a2b3b05,0x8cb89a7db77c506a, 0x8eb98a7a9a5b04e3,0x77f3608e92adb242,
+                    0xb267ed1940f1c61c,0x55f038b237591ed3, 0xdf01e85f912e37a3,0x6b6c46dec52f6688,
+                    0x8b61313bbabce2c6,0x2323ac4b3b3da015, 0xae397d8aa96c1b77,0xabec975e0a0d081a,
+                    0xd9c7dced53c72255,0x96e7bd358c904a21, 0x881cea14545c7575,0x7e50d64177da2e54,
+                    0xaa242499697392d2,0xdde50bd1d5d0b9e9, 0xd4ad2dbfc3d07787,0x955e4ec64b44e864,
+                    0x84ec3c97da624ab4,0xbd5af13bef0b113e, 0xa6274bbdd0fadd61,0xecb1ad8aeacdd58e,
+                    0xcfb11ead453994ba,0x67de18eda5814af2, 0x81ceb32c4b43fcf4,0x80eacf948770ced7,
+                    0xa2425ff75e14fc31,0xa1258379a94d028d, 0xcad2f7f5359a3b3e,0x096ee45813a04330,
+                    0xfd87b5f28300ca0d,0x8bca9d6e188853fc, 0x9e74d1b791e07e48,0x775ea264cf55347e,
+                    0xc612062576589dda,0x95364afe032a819e, 0xf79687aed3eec551,0x3a83ddbd83f52205,
+                    0x9abe14cd44753b52,0xc4926a9672793543, 0xc16d9a0095928a27,0x75b7053c0f178294,
+                    0xf1c90080baf72cb1,0x5324c68b12dd6339, 0x971da05074da7bee,0xd3f6fc16ebca5e04,
+                    0xbce5086492111aea,0x88f4bb1ca6bcf585, 0xec1e4a7db69561a5,0x2b31e9e3d06c32e6,
+                    0x9392ee8e921d5d07,0x3aff322e62439fd0, 0xb877aa3236a4b449,0x09befeb9fad487c3,
+                    0xe69594bec44de15b,0x4c2ebe687989a9b4, 0x901d7cf73ab0acd9,0x0f9d37014bf60a11,
+                    0xb424dc35095cd80f,0x538484c19ef38c95, 0xe12e13424bb40e13,0x2865a5f206b06fba,
+                    0x8cbccc096f5088cb,0xf93f87b7442e45d4, 0xafebff0bcb24aafe,0xf78f69a51539d749,
+                    0xdbe6fecebdedd5be,0xb573440e5a884d1c, 0x89705f4136b4a597,0x31680a88f8953031,
+                    0xabcc77118461cefc,0xfdc20d2b36ba7c3e, 0xd6bf94d5e57a42bc,0x3d32907604691b4d,
+                    0x8637bd05af6c69b5,0xa63f9a49c2c1b110, 0xa7c5ac471b478423,0x0fcf80dc33721d54,
+                    0xd1b71758e219652b,0xd3c36113404ea4a9, 0x83126e978d4fdf3b,0x645a1cac083126ea,
+                    0xa3d70a3d70a3d70a,0x3d70a3d70a3d70a4, 0xcccccccccccccccc,0xcccccccccccccccd,
+                    0x8000000000000000,0x0000000000000000, 0xa000000000000000,0x0000000000000000,
+                    0xc800000000000000,0x0000000000000000, 0xfa00000000000000,0x0000000000000000,
+                    0x9c40000000000000,0x0000000000000000, 0xc350000000000000,0x0000000000000000,
+                    0xf424000000000000,0x0000000000000000, 0x9896800000000000,0x0000000000000000,
+                    0xbebc200000000000,0x0000000000000000, 0xee6b280000000000,0x0000000000000000,
+                    0x9502f90000000000,0x0000000000000000, 0xba43b74000000000,0x0000000000000000,
+                    0xe8d4a51000000000,0x0000000000000000, 0x9184e72a00000000,0x0000000000000000,
+                    0xb5e620f480000000,0x0000000000000000, 0xe35fa931a0000000,0x0000000000000000,
+                    0x8e1bc9bf04000000,0x0000000000000000, 0xb1a2bc2ec5000000,0x0000000000000000,
+                    0xde0b6b3a76400000,0x0000000000000000, 0x8ac7230489e80000,0x0000000000000000,
+                    0xad78ebc5ac620000,0x0000000000000000, 0xd8d726b7177a8000,0x0000000000000000,
+                    0x878678326eac9000,0x0000000000000000, 0xa968163f0a57b400,0x0000000000000000,
+                    0xd3c21bcecceda100,0x0000000000000000, 0x84595161401484a0,0x0000000000000000,
+                    0xa56fa5b99019a5c8,0x0000000000000000, 0xcecb8f27f4200f3a,0x0000000000000000,
+                    0x813f3978f8940984,0x4000000000000000, 0xa18f07d736b90be5,0x5000000000000000,
+                    0xc9f2c9cd04674ede,0xa400000000000000, 0xfc6f7c4045812296,0x4d00000000000000,
+                    0x9dc5ada82b70b59d,0xf020000000000000, 0xc5371912364ce305,0x6c28000000000000,
+                    0xf684df56c3e01bc6,0xc732000000000000, 0x9a130b963a6c115c,0x3c7f400000000000,
+                    0xc097ce7bc90715b3,0x4b9f100000000000, 0xf0bdc21abb48db20,0x1e86d40000000000,
+                    0x96769950b50d88f4,0x1314448000000000, 0xbc143fa4e250eb31,0x17d955a000000000,
+                    0xeb194f8e1ae525fd,0x5dcfab0800000000, 0x92efd1b8d0cf37be,0x5aa1cae500000000,
+                    0xb7abc627050305ad,0xf14a3d9e40000000, 0xe596b7b0c643c719,0x6d9ccd05d0000000,
+                    0x8f7e32ce7bea5c6f,0xe4820023a2000000, 0xb35dbf821ae4f38b,0xdda2802c8a800000,
+                    0xe0352f62a19e306e,0xd50b2037ad200000, 0x8c213d9da502de45,0x4526f422cc340000,
+                    0xaf298d050e4395d6,0x9670b12b7f410000, 0xdaf3f04651d47b4c,0x3c0cdd765f114000,
+                    0x88d8762bf324cd0f,0xa5880a69fb6ac800, 0xab0e93b6efee0053,0x8eea0d047a457a00,
+                    0xd5d238a4abe98068,0x72a4904598d6d880, 0x85a36366eb71f041,0x47a6da2b7f864750,
+                    0xa70c3c40a64e6c51,0x999090b65f67d924, 0xd0cf4b50cfe20765,0xfff4b4e3f741cf6d,
+                    0x82818f1281ed449f,0xbff8f10e7a8921a4, 0xa321f2d7226895c7,0xaff72d52192b6a0d,
+                    0xcbea6f8ceb02bb39,0x9bf4f8a69f764490, 0xfee50b7025c36a08,0x02f236d04753d5b4,
+                    0x9f4f2726179a2245,0x01d762422c946590, 0xc722f0ef9d80aad6,0x424d3ad2b7b97ef5,
+                    0xf8ebad2b84e0d58b,0xd2e0898765a7deb2, 0x9b934c3b330c8577,0x63cc55f49f88eb2f,
+                    0xc2781f49ffcfa6d5,0x3cbf6b71c76b25fb, 0xf316271c7fc3908a,0x8bef464e3945ef7a,
+                    0x97edd871cfda3a56,0x97758bf0e3cbb5ac, 0xbde94e8e43d0c8ec,0x3d52eeed1cbea317,
+                    0xed63a231d4c4fb27,0x4ca7aaa863ee4bdd, 0x945e455f24fb1cf8,0x8fe8caa93e74ef6a,
+                    0xb975d6b6ee39e436,0xb3e2fd538e122b44, 0xe7d34c64a9c85d44,0x60dbbca87196b616,
+                    0x90e40fbeea1d3a4a,0xbc8955e946fe31cd, 0xb51d13aea4a488dd,0x6babab6398bdbe41,
+                    0xe264589a4dcdab14,0xc696963c7eed2dd1, 0x8d7eb76070a08aec,0xfc1e1de5cf543ca2,
+                    0xb0de65388cc8ada8,0x3b25a55f43294bcb, 0xdd15fe86affad912,0x49ef0eb713f39ebe,
+                    0x8a2dbf142dfcc7ab,0x6e3569326c784337, 0xacb92ed9397bf996,0x49c2c37f07965404,
+                    0xd7e77a8f87daf7fb,0xdc33745ec97be906, 0x86f0ac99b4e8dafd,0x69a028bb3ded71a3,
+                    0xa8acd7c0222311bc,0xc40832ea0d68ce0c, 0xd2d80db02aabd62b,0xf50a3fa490c30190,
+                    0x83c7088e1aab65db,0x792667c6da79e0fa, 0xa4b8cab1a1563f52,0x577001b891185938,
+                    0xcde6fd5e09abcf26,0xed4c0226b55e6f86, 0x80b05e5ac60b6178,0x544f8158315b05b4,
+                    0xa0dc75f1778e39d6,0x696361ae3db1c721, 0xc913936dd571c84c,0x03bc3a19cd1e38e9,
+                    0xfb5878494ace3a5f,0x04ab48a04065c723, 0x9d174b2dcec0e47b,0x62eb0d64283f9c76,
+                    0xc45d1df942711d9a,0x3ba5d0bd324f8394, 0xf5746577930d6500,0xca8f44ec7ee36479,
+                    0x9968bf6abbe85f20,0x7e998b13cf4e1ecb, 0xbfc2ef456ae276e8,0x9e3fedd8c321a67e,
+                    0xefb3ab16c59b14a2,0xc5cfe94ef3ea101e, 0x95d04aee3b80ece5,0xbba1f1d158724a12,
+                    0xbb445da9ca61281f,0x2a8a6e45ae8edc97, 0xea1575143cf97226,0xf52d09d71a3293bd,
+                    0x924d692ca61be758,0x593c2626705f9c56, 0xb6e0c377cfa2e12e,0x6f8b2fb00c77836c,
+                    0xe498f455c38b997a,0x0b6dfb9c0f956447, 0x8edf98b59a373fec,0x4724bd4189bd5eac,
+                    0xb2977ee300c50fe7,0x58edec91ec2cb657, 0xdf3d5e9bc0f653e1,0x2f2967b66737e3ed,
+                    0x8b865b215899f46c,0xbd79e0d20082ee74, 0xae67f1e9aec07187,0xecd8590680a3aa11,
+                    0xda01ee641a708de9,0xe80e6f4820cc9495, 0x884134fe908658b2,0x3109058d147fdcdd,
+                    0xaa51823e34a7eede,0xbd4b46f0599fd415, 0xd4e5e2cdc1d1ea96,0x6c9e18ac7007c91a,
+                    0x850fadc09923329e,0x03e2cf6bc604ddb0, 0xa6539930bf6bff45,0x84db8346b786151c,
+                    0xcfe87f7cef46ff16,0xe612641865679a63, 0x81f14fae158c5f6e,0x4fcb7e8f3f60c07e,
+                    0xa26da3999aef7749,0xe3be5e330f38f09d, 0xcb090c8001ab551c,0x5cadf5bfd3072cc5,
+                    0xfdcb4fa002162a63,0x73d9732fc7c8f7f6, 0x9e9f11c4014dda7e,0x2867e7fddcdd9afa,
+                    0xc646d63501a1511d,0xb281e1fd541501b8, 0xf7d88bc24209a565,0x1f225a7ca91a4226,
+                    0x9ae757596946075f,0x3375788de9b06958, 0xc1a12d2fc3978937,0x0052d6b1641c83ae,
+                    0xf209787bb47d6b84,0xc0678c5dbd23a49a, 0x9745eb4d50ce6332,0xf840b7ba963646e0,
+                    0xbd176620a501fbff,0xb650e5a93bc3d898, 0xec5d3fa8ce427aff,0xa3e51f138ab4cebe,
+                    0x93ba47c980e98cdf,0xc66f336c36b10137, 0xb8a8d9bbe123f017,0xb80b0047445d4184,
+                    0xe6d3102ad96cec1d,0xa60dc059157491e5, 0x9043ea1ac7e41392,0x87c89837ad68db2f,
+                    0xb454e4a179dd1877,0x29babe4598c311fb, 0xe16a1dc9d8545e94,0xf4296dd6fef3d67a,
+                    0x8ce2529e2734bb1d,0x1899e4a65f58660c, 0xb01ae745b101e9e4,0x5ec05dcff72e7f8f,
+                    0xdc21a1171d42645d,0x76707543f4fa1f73, 0x899504ae72497eba,0x6a06494a791c53a8,
+                    0xabfa45da0edbde69,0x0487db9d17636892, 0xd6f8d7509292d603,0x45a9d2845d3c42b6,
+                    0x865b86925b9bc5c2,0x0b8a2392ba45a9b2, 0xa7f26836f282b732,0x8e6cac7768d7141e,
+                    0xd1ef0244af2364ff,0x3207d795430cd926, 0x8335616aed761f1f,0x7f44e6bd49e807b8,
+                    0xa402b9c5a8d3a6e7,0x5f16206c9c6209a6, 0xcd036837130890a1,0x36dba887c37a8c0f,
+                    0x802221226be55a64,0xc2494954da2c9789, 0xa02aa96b06deb0fd,0xf2db9baa10b7bd6c,
+                    0xc83553c5c8965d3d,0x6f92829494e5acc7, 0xfa42a8b73abbf48c,0xcb772339ba1f17f9,
+                    0x9c69a97284b578d7,0xff2a760414536efb, 0xc38413cf25e2d70d,0xfef5138519684aba,
+                    0xf46518c2ef5b8cd1,0x7eb258665fc25d69, 0x98bf2f79d5993802,0xef2f773ffbd97a61,
+                    0xbeeefb584aff8603,0xaafb550ffacfd8fa, 0xeeaaba2e5dbf6784,0x95ba2a53f983cf38,
+                    0x952ab45cfa97a0b2,0xdd945a747bf26183, 0xba756174393d88df,0x94f971119aeef9e4,
+                    0xe912b9d1478ceb17,0x7a37cd5601aab85d, 0x91abb422ccb812ee,0xac62e055c10ab33a,
+                    0xb616a12b7fe617aa,0x577b986b314d6009, 0xe39c49765fdf9d94,0xed5a7e85fda0b80b,
+                    0x8e41ade9fbebc27d,0x14588f13be847307, 0xb1d219647ae6b31c,0x596eb2d8ae258fc8,
+                    0xde469fbd99a05fe3,0x6fca5f8ed9aef3bb, 0x8aec23d680043bee,0x25de7bb9480d5854,
+                    0xada72ccc20054ae9,0xaf561aa79a10ae6a, 0xd910f7ff28069da4,0x1b2ba1518094da04,
+                    0x87aa9aff79042286,0x90fb44d2f05d0842, 0xa99541bf57452b28,0x353a1607ac744a53,
+                    0xd3fa922f2d1675f2,0x42889b8997915ce8, 0x847c9b5d7c2e09b7,0x69956135febada11,
+                    0xa59bc234db398c25,0x43fab9837e699095, 0xcf02b2c21207ef2e,0x94f967e45e03f4bb,
+                    0x8161afb94b44f57d,0x1d1be0eebac278f5, 0xa1ba1ba79e1632dc,0x6462d92a69731732,
+                    0xca28a291859bbf93,0x7d7b8f7503cfdcfe, 0xfcb2cb35e702af78,0x5cda735244c3d43e,
+                    0x9defbf01b061adab,0x3a0888136afa64a7, 0xc56baec21c7a1916,0x088aaa1845b8fdd0,
+                    0xf6c69a72a3989f5b,0x8aad549e57273d45, 0x9a3c2087a63f6399,0x36ac54e2f678864b,
+                    0xc0cb28a98fcf3c7f,0x84576a1bb416a7dd, 0xf0fdf2d3f3c30b9f,0x656d44a2a11c51d5,
+                    0x969eb7c47859e743,0x9f644ae5a4b1b325, 0xbc4665b596706114,0x873d5d9f0dde1fee,
+                    0xeb57ff22fc0c7959,0xa90cb506d155a7ea, 0x9316ff75dd87cbd8,0x09a7f12442d588f2,
+                    0xb7dcbf5354e9bece,0x0c11ed6d538aeb2f, 0xe5d3ef282a242e81,0x8f1668c8a86da5fa,
+                    0x8fa475791a569d10,0xf96e017d694487bc, 0xb38d92d760ec4455,0x37c981dcc395a9ac,
+                    0xe070f78d3927556a,0x85bbe253f47b1417, 0x8c469ab843b89562,0x93956d7478ccec8e,
+                    0xaf58416654a6babb,0x387ac8d1970027b2, 0xdb2e51bfe9d0696a,0x06997b05fcc0319e,
+                    0x88fcf317f22241e2,0x441fece3bdf81f03, 0xab3c2fddeeaad25a,0xd527e81cad7626c3,
+                    0xd60b3bd56a5586f1,0x8a71e223d8d3b074, 0x85c7056562757456,0xf6872d5667844e49,
+                    0xa738c6bebb12d16c,0xb428f8ac016561db, 0xd106f86e69d785c7,0xe13336d701beba52,
+                    0x82a45b450226b39c,0xecc0024661173473, 0xa34d721642b06084,0x27f002d7f95d0190,
+                    0xcc20ce9bd35c78a5,0x31ec038df7b441f4, 0xff290242c83396ce,0x7e67047175a15271,
+                    0x9f79a169bd203e41,0x0f0062c6e984d386, 0xc75809c42c684dd1,0x52c07b78a3e60868,
+                    0xf92e0c3537826145,0xa7709a56ccdf8a82, 0x9bbcc7a142b17ccb,0x88a66076400bb691,
+                    0xc2abf989935ddbfe,0x6acff893d00ea435, 0xf356f7ebf83552fe,0x0583f6b8c4124d43,
+                    0x98165af37b2153de,0xc3727a337a8b704a, 0xbe1bf1b059e9a8d6,0x744f18c0592e4c5c,
+                    0xeda2ee1c7064130c,0x1162def06f79df73, 0x9485d4d1c63e8be7,0x8addcb5645ac2ba8,
+                    0xb9a74a0637ce2ee1,0x6d953e2bd7173692, 0xe8111c87c5c1ba99,0xc8fa8db6ccdd0437,
+                    0x910ab1d4db9914a0,0x1d9c9892400a22a2, 0xb54d5e4a127f59c8,0x2503beb6d00cab4b,
+                    0xe2a0b5dc971f303a,0x2e44ae64840fd61d, 0x8da471a9de737e24,0x5ceaecfed289e5d2,
+                    0xb10d8e1456105dad,0x7425a83e872c5f47, 0xdd50f1996b947518,0xd12f124e28f77719,
+                    0x8a5296ffe33cc92f,0x82bd6b70d99aaa6f, 0xace73cbfdc0bfb7b,0x636cc64d1001550b,
+                    0xd8210befd30efa5a,0x3c47f7e05401aa4e, 0x8714a775e3e95c78,0x65acfaec34810a71,
+                    0xa8d9d1535ce3b396,0x7f1839a741a14d0d, 0xd31045a8341ca07c,0x1ede48111209a050,
+                    0x83ea2b892091e44d,0x934aed0aab460432, 0xa4e4b66b68b65d60,0xf81da84d5617853f,
+                    0xce1de40642e3f4b9,0x36251260ab9d668e, 0x80d2ae83e9ce78f3,0xc1d72b7c6b426019,
+                    0xa1075a24e4421730,0xb24cf65b8612f81f, 0xc94930ae1d529cfc,0xdee033f26797b627,
+                    0xfb9b7cd9a4a7443c,0x169840ef017da3b1, 0x9d412e0806e88aa5,0x8e1f289560ee864e,
+                    0xc491798a08a2ad4e,0xf1a6f2bab92a27e2, 0xf5b5d7ec8acb58a2,0xae10af696774b1db,
+                    0x9991a6f3d6bf1765,0xacca6da1e0a8ef29, 0xbff610b0cc6edd3f,0x17fd090a58d32af3,
+                    0xeff394dcff8a948e,0xddfc4b4cef07f5b0, 0x95f83d0a1fb69cd9,0x4abdaf101564f98e,
+                    0xbb764c4ca7a4440f,0x9d6d1ad41abe37f1, 0xea53df5fd18d5513,0x84c86189216dc5ed,
+                    0x92746b9be2f8552c,0x32fd3cf5b4e49bb4, 0xb7118682dbb66a77,0x3fbc8c33221dc2a1,
+                    0xe4d5e82392a40515,0x0fabaf3feaa5334a, 0x8f05b1163ba6832d,0x29cb4d87f2a7400e,
+                    0xb2c71d5bca9023f8,0x743e20e9ef511012, 0xdf78e4b2bd342cf6,0x914da9246b255416,
+                    0x8bab8eefb6409c1a,0x1ad089b6c2f7548e, 0xae9672aba3d0c320,0xa184ac2473b529b1,
+                    0xda3c0f568cc4f3e8,0xc9e5d72d90a2741e, 0x8865899617fb1871,0x7e2fa67c7a658892,
+                    0xaa7eebfb9df9de8d,0xddbb901b98feeab7, 0xd51ea6fa85785631,0x552a74227f3ea565,
+                    0x8533285c936b35de,0xd53a88958f87275f, 0xa67ff273b8460356,0x8a892abaf368f137,
+                    0xd01fef10a657842c,0x2d2b7569b0432d85, 0x8213f56a67f6b29b,0x9c3b29620e29fc73,
+                    0xa298f2c501f45f42,0x8349f3ba91b47b8f, 0xcb3f2f7642717713,0x241c70a936219a73,
+                    0xfe0efb53d30dd4d7,0xed238cd383aa0110, 0x9ec95d1463e8a506,0xf4363804324a40aa,
+                    0xc67bb4597ce2ce48,0xb143c6053edcd0d5, 0xf81aa16fdc1b81da,0xdd94b7868e94050a,
+                    0x9b10a4e5e9913128,0xca7cf2b4191c8326, 0xc1d4ce1f63f57d72,0xfd1c2f611f63a3f0,
+                    0xf24a01a73cf2dccf,0xbc633b39673c8cec, 0x976e41088617ca01,0xd5be0503e085d813,
+                    0xbd49d14aa79dbc82,0x4b2d8644d8a74e18, 0xec9c459d51852ba2,0xddf8e7d60ed1219e,
+                    0x93e1ab8252f33b45,0xcabb90e5c942b503, 0xb8da1662e7b00a17,0x3d6a751f3b936243,
+                    0xe7109bfba19c0c9d,0x0cc512670a783ad4, 0x906a617d450187e2,0x27fb2b80668b24c5,
+                    0xb484f9dc9641e9da,0xb1f9f660802dedf6, 0xe1a63853bbd26451,0x5e7873f8a0396973,
+                    0x8d07e33455637eb2,0xdb0b487b6423e1e8, 0xb049dc016abc5e5f,0x91ce1a9a3d2cda62,
+                    0xdc5c5301c56b75f7,0x7641a140cc7810fb, 0x89b9b3e11b6329ba,0xa9e904c87fcb0a9d,
+                    0xac2820d9623bf429,0x546345fa9fbdcd44, 0xd732290fbacaf133,0xa97c177947ad4095,
+                    0x867f59a9d4bed6c0,0x49ed8eabcccc485d, 0xa81f301449ee8c70,0x5c68f256bfff5a74,
+                    0xd226fc195c6a2f8c,0x73832eec6fff3111, 0x83585d8fd9c25db7,0xc831fd53c5ff7eab,
+                    0xa42e74f3d032f525,0xba3e7ca8b77f5e55, 0xcd3a1230c43fb26f,0x28ce1bd2e55f35eb,
+                    0x80444b5e7aa7cf85,0x7980d163cf5b81b3, 0xa0555e361951c366,0xd7e105bcc332621f,
+                    0xc86ab5c39fa63440,0x8dd9472bf3fefaa7, 0xfa856334878fc150,0xb14f98f6f0feb951,
+                    0x9c935e00d4b9d8d2,0x6ed1bf9a569f33d3, 0xc3b8358109e84f07,0x0a862f80ec4700c8,
+                    0xf4a642e14c6262c8,0xcd27bb612758c0fa, 0x98e7e9cccfbd7dbd,0x8038d51cb897789c,
+                    0xbf21e44003acdd2c,0xe0470a63e6bd56c3, 0xeeea5d5004981478,0x1858ccfce06cac74,
+                    0x95527a5202df0ccb,0x0f37801e0c43ebc8, 0xbaa718e68396cffd,0xd30560258f54e6ba,
+                    0xe950df20247c83fd,0x47c6b82ef32a2069, 0x91d28b7416cdd27e,0x4cdc331d57fa5441,
+                    0xb6472e511c81471d,0xe0133fe4adf8e952, 0xe3d8f9e563a198e5,0x58180fddd97723a6,
+                    0x8e679c2f5e44ff8f,0x570f09eaa7ea7648,
+            };
+            return table;
+        }
+
+        // Eisel-Lemire: the correctly rounded double nearest to w * 10^q, as raw bits, for any w of at
+        // most 19 decimal digits. See Lemire, "Number Parsing at a Gigabyte per Second" (2021) and
+        // Mushtak & Lemire, "Fast Number Parsing Without Fallback" (2023).
+        inline uint64_t eisel_lemire(int64_t q, uint64_t w) {
+            if (w == 0 || q < -342) return 0;
+            if (q > 308) return 0x7FFULL << 52;
+
+            int lz = static_cast<int>(clz64(w));
+            w <<= lz;
+
+            const uint64_t* pow5 = power_of_five_128() + 2 * (q + 342);
+            uint64_t hi, lo;
+            mul128(w, pow5[0], hi, lo);
+
+            const uint64_t precision_mask = 0xFFFFFFFFFFFFFFFFULL >> 55;
+            if ((hi & precision_mask) == precision_mask) {
+                uint64_t hi2, lo2;
+                mul128(w, pow5[1], hi2, lo2);
+                lo += hi2;
+                if (hi2 > lo) ++hi;
+            }
+
+            int upperbit = static_cast<int>(hi >> 63);
+            int shift = upperbit + 64 - 52 - 3;
+            uint64_t mantissa = hi >> shift;
+            int power2 = static_cast<int>((((152170 + 65536) * q) >> 16) + 63) + upperbit - lz + 1023;
+
+            if (power2 <= 0) {
+                if (-power2 + 1 >= 64) return 0;
+                mantissa >>= -power2 + 1;
+                mantissa += mantissa & 1;
+                mantissa >>= 1;
+                return mantissa;
+            }
+
+            // Exactly halfway between two doubles: round to even instead of up.
+            if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == hi) {
+                mantissa &= ~1ULL;
+            }
+
+            mantissa += mantissa & 1;
+            mantissa >>= 1;
+            if (mantissa >= (2ULL << 52)) {
+                mantissa = 1ULL << 52;
+                ++power2;
+            }
+            mantissa &= ~(1ULL << 52);
+
+            if (power2 >= 0x7FF) return 0x7FFULL << 52;
+            return (static_cast<uint64_t>(power2) << 52) | mantissa;
+        }
+
+        // Rounds q * 2^e2 (plus a nonzero remainder below q, if sticky) to the nearest double, ties to even.
+        inline uint64_t round_to_double(uint64_t q, int e2, bool sticky) {
+            int lz = static_cast<int>(clz64(q));
+            q <<= lz;
+            e2 -= lz;
+
+            int exponent = e2 + 63;
+            if (exponent > 1023) return 0x7FFULL << 52;
+
+            int shift = exponent >= -1022 ? 11 : 11 + (-1022 - exponent);
+            if (shift > 64) return 0;
+
+            uint64_t mantissa = shift == 64 ? 0 : q >> shift;
+            uint64_t rest = shift == 64 ? q : q & ((1ULL << shift) - 1);
+            uint64_t half = 1ULL << (shift - 1);
+            if (rest > half || (rest == half && (sticky || (mantissa & 1)))) ++mantissa;
+
+            if (exponent < -1022) return mantissa;
+
+            if (mantissa == (1ULL << 53)) {
+                mantissa >>= 1;
+                ++exponent;
+                if (exponent > 1023) return 0x7FFULL << 52;
+            }
+            return (static_cast<uint64_t>(exponent + 1023) << 52) | (mantissa & ((1ULL << 52) - 1));
+        }
+
+        // Minimal arbitrary-precision unsigned integer for the rare inputs Eisel-Lemire cannot settle.
+        class BigInt {
+            std::vector<uint32_t> limbs;
+
+            void trim() {
+                while (!limbs.empty() && limbs.back() == 0) limbs.pop_back();
+            }
+
+        public:
+            BigInt() {}
+
+            bool zero() const { return limbs.empty(); }
+
+            void mul_add(uint32_t m, uint32_t a) {
+                uint64_t carry = a;
+                for (uint32_t& limb : limbs) {
+                    uint64_t v = static_cast<uint64_t>(limb) * m + carry;
+                    limb = static_cast<uint32_t>(v);
+                    carry = v >> 32;
+                }
+                if (carry) limbs.push_back(static_cast<uint32_t>(carry));
+            }
+
+            void mul_pow10(int64_t k) {
+                for (; k >= 9; k -= 9) mul_add(1000000000, 0);
+                static const uint32_t small[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+                if (k > 0) mul_add(small[k], 0);
+            }
+
+            void shl(size_t bits) {
+                if (zero() || bits == 0) return;
+                size_t words = bits / 32;
+                unsigned rem = static_cast<unsigned>(bits % 32);
+                if (rem) {
+                    uint32_t carry = 0;
+                    for (uint32_t& limb : limbs) {
+                        uint32_t next = limb >> (32 - rem);
+                        limb = (limb << rem) | carry;
+                        carry = next;
+                    }
+                    if (carry) limbs.push_back(carry);
+                }
+                limbs.insert(limbs.begin(), words, 0);
+            }
+
+            size_t bit_length() const {
+                if (zero()) return 0;
+                return limbs.size() * 32 - (clz64(limbs.back()) - 32);
+            }
+
+            bool bit(size_t i) const {
+                size_t w = i / 32;
+                return w < limbs.size() && ((limbs[w] >> (i % 32)) & 1);
+            }
+
+            // Bits [from, from + 64) as an integer, and whether any bit below from is set.
+            uint64_t bits_from(size_t from, bool& sticky) const {
+                uint64_t v = 0;
+                for (size_t i = 0; i < 64; i++) {
+                    if (bit(from + i)) v |= 1ULL << i;
+                }
+                sticky = false;
+                for (size_t i = 0; i < from && !sticky; i++) sticky = bit(i);
+                return v;
+            }
+
+            int compare(const BigInt& that) const {
+                if (limbs.size() != that.limbs.size()) return limbs.size() < that.limbs.size() ? -1 : 1;
+                for (size_t i = limbs.size(); i-- > 0;) {
+                    if (limbs[i] != that.limbs[i]) return limbs[i] < that.limbs[i] ? -1 : 1;
+                }
+                return 0;
+            }
+
+            // this -= that, where that <= this.
+            void sub(const BigInt& that) {
+                int64_t borrow = 0;
+                for (size_t i = 0; i < limbs.size(); i++) {
+                    int64_t v = static_cast<int64_t>(limbs[i]) - borrow - (i < that.limbs.size() ? that.limbs[i] : 0);
+                    borrow = v < 0;
+                    limbs[i] = static_cast<uint32_t>(v + (borrow << 32));
+                }
+                trim();
+            }
+        };
+
+        // Exact conversion of digits[0, n) * 10^e10 to double bits, by big-integer arithmetic.
+        inline uint64_t decimal_to_double(const char* digits, size_t n, int64_t e10) {
+            BigInt num;
+            for (size_t i = 0; i < n; i++) num.mul_add(10, static_cast<uint32_t>(digits[i] - '0'));
+            if (num.zero()) return 0;
+
+            if (e10 >= 0) {
+                num.mul_pow10(e10);
+                size_t len = num.bit_length();
+                bool sticky = false;
+                if (len <= 64) return round_to_double(num.bits_from(0, sticky), 0, false);
+                uint64_t q = num.bits_from(len - 64, sticky);
+                return round_to_double(q, static_cast<int>(len - 64), sticky);
+            }
+
+            BigInt den;
+            den.mul_add(1, 1);
+            den.mul_pow10(-e10);
+
+            // Scale so that the quotient has 63 or 64 bits, then divide bit by bit.
+            int64_t s = 63 + static_cast<int64_t>(den.bit_length()) - static_cast<int64_t>(num.bit_length());
+            if (s >= 0) num.shl(static_cast<size_t>(s));
+            else den.shl(static_cast<size_t>(-s));
+
+            uint64_t q = 0;
+            for (int k = 63; k >= 0; k--) {
+                BigInt t = den;
+                t.shl(static_cast<size_t>(k));
+                if (num.compare(t) >= 0) {
+                    num.sub(t);
+                    q |= 1ULL << k;
+                }
+            }
+            return round_to_double(q, static_cast<int>(-s), !num.zero());
+        }
+
+        // w * 10^q for a w of at most 19 digits.
+        inline double to_double(uint64_t w, int64_t q, bool negative) {
+            static const double pow10[] = {
+                    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+            };
+
+            double d;
+            if (w <= (1ULL << 53) && q >= -22 && q <= 22) {
+                // Clinger's fast path: both operands are exact, so one IEEE operation rounds correctly.
+                d = static_cast<double>(w);
+                d = q < 0 ? d / pow10[-q] : d * pow10[q];
+            } else {
+                d = bits_to_double(eisel_lemire(q, w));
+            }
+            return negative ? -d : d;
+        }
+
+        struct NumberResult {
+            bool integral;
+            int64_t integer;
+            double dbl;
+        };
+
+        inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+        inline const char* scan_digits(const char* p, const char* end, uint64_t& w) {
+            while (end - p >= 8) {
+                uint64_t v = load_u64_le(p);
+                if (!is_eight_digits(v)) break;
+                w = w * 100000000 + parse_eight_digits(v);
+                p += 8;
+            }
+            while (p != end && is_digit(*p)) {
+                w = w * 10 + static_cast<uint64_t>(*p - '0');
+                ++p;
+            }
+            return p;
+        }
+
+        // Parses a JSON number at p without going through libc, so the result does not depend on the
+        // locale. Integers that fit in int64_t are returned as such. On failure returns false with p
+        // pointing at the offending byte.
+        inline bool parse_number(const char*& p, const char* end, NumberResult& out) {
+            bool negative = false;
+            if (p != end && *p == '-') {
+                negative = true;
+                ++p;
+            }
+
+            if (p == end || !is_digit(*p)) return false;
+
+            const char* int_begin = p;
+            uint64_t w = 0;
+            if (*p == '0') ++p;
+            else p = scan_digits(p, end, w);
+            size_t int_digits = static_cast<size_t>(p - int_begin);
+
+            bool integral = true;
+            const char* frac_begin = p;
+            const char* frac_end = p;
+            if (p != end && *p == '.') {
+                integral = false;
+                frac_begin = ++p;
+                p = scan_digits(p, end, w);
+                frac_end = p;
+                if (frac_begin == frac_end) return false;
+            }
+
+            int64_t exponent = 0;
+            if (p != end && (*p == 'e' || *p == 'E')) {
+                integral = false;
+                ++p;
+                bool exp_negative = false;
+                if (p != end && (*p == '+' || *p == '-')) exp_negative = *p++ == '-';
+                if (p == end || !is_digit(*p)) return false;
+                for (; p != end && is_digit(*p); ++p) {
+                    if (exponent < 0x10000000) exponent = exponent * 10 + (*p - '0');
+                }
+                if (exp_negative) exponent = -exponent;
+            }
+
+            size_t frac_digits = static_cast<size_t>(frac_end - frac_begin);
+            size_t digits = int_digits + frac_digits;
+
+            if (integral && digits <= 19) {
+                if (!negative && w <= static_cast<uint64_t>(INT64_MAX)) {
+                    out.integral = true;
+                    out.integer = static_cast<int64_t>(w);
+                    return true;
+                }
+                if (negative && w <= static_cast<uint64_t>(INT64_MAX) + 1) {
+                    out.integral = true;
+                    out.integer = w == static_cast<uint64_t>(INT64_MAX) + 1 ? INT64_MIN : -static_cast<int64_t>(w);
+                    return true;
+                }
+            }
+
+            out.integral = false;
+            int64_t q = exponent - static_cast<int64_t>(frac_digits);
+            if (digits <= 19) {
+                out.dbl = to_double(w, q, negative);
+                return true;
+            }
+
+            // Too many digits for w to be exact. Collect the significant ones; if rounding the first 19 up
+            // or down gives the same double we are done, otherwise fall back to exact arithmetic.
+            std::string sig;
+            for (const char* d = int_begin; d != frac_end; ++d) {
+                if (*d == '.' || (*d == '0' && sig.empty())) continue;
+                sig.push_back(*d);
+            }
+            if (sig.empty()) {
+                out.dbl = negative ? -0.0 : 0.0;
+                return true;
+            }
+
+            int64_t e10 = q;
+            size_t dropped = 0;
+            while (sig.size() > 1 && sig[sig.size() - 1] == '0') {
+                sig.erase(sig.size() - 1);
+                ++dropped;
+            }
+            e10 += static_cast<int64_t>(dropped);
+
+            if (sig.size() <= 19) {
+                uint64_t v = 0;
+                for (char c : sig) v = v * 10 + static_cast<uint64_t>(c - '0');
+                out.dbl = to_double(v, e10, negative);
+                return true;
+            }
+
+            int64_t lead = e10 + static_cast<int64_t>(sig.size()) - 1;
+            if (lead > 308 || lead < -326) {
+                out.dbl = lead > 308 ? HUGE_VAL : 0.0;
+                if (negative) out.dbl = -out.dbl;
+                return true;
+            }
+
+            uint64_t w19 = 0;
+            for (size_t i = 0; i < 19; i++) w19 = w19 * 10 + static_cast<uint64_t>(sig[i] - '0');
+            int64_t q19 = e10 + static_cast<int64_t>(sig.size()) - 19;
+            uint64_t lo = eisel_lemire(q19, w19);
+            uint64_t bits = lo == eisel_lemire(q19, w19 + 1) ? lo : 0;
+
+            if (!bits) {
+                // 768 significant digits always decide the rounding; anything beyond only matters as a
+                // nonzero tail, which one extra digit represents.
+                const size_t max_digits = 800;
+                if (sig.size() > max_digits) {
+                    e10 += static_cast<int64_t>(sig.size() - max_digits) - 1;
+                    sig.resize(max_digits);
+                    sig.push_back('1');
+                }
+                bits = decimal_to_double(sig.data(), sig.size(), e10);
+            }
+
+            out.dbl = negative ? -bits_to_double(bits) : bits_to_double(bits);
+            return true;
+        }
+
+        // --- Formatting ---
+
+        inline char* write_uint(char* buf, uint64_t v) {
+            static const char pairs[] =
+                    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                    "8081828384858687888990919293949596979899";
+
+            char tmp[20];
+            char* t = tmp + sizeof(tmp);
+            while (v >= 100) {
+                unsigned r = static_cast<unsigned>(v % 100) * 2;
+                v /= 100;
+                *--t = pairs[r + 1];
+                *--t = pairs[r];
+            }
+            if (v >= 10) {
+                unsigned r = static_cast<unsigned>(v) * 2;
+                *--t = pairs[r + 1];
+                *--t = pairs[r];
+            } else {
+                *--t = static_cast<char>('0' + v);
+            }
+
+            size_t n = static_cast<size_t>(tmp + sizeof(tmp) - t);
+            std::memcpy(buf, t, n);
+            return buf + n;
+        }
+
+        // Grisu2 (Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers", 2010)
+        // in the formulation popularized by nlohmann/json: always round-trips, and is the shortest
+        // representation in all but a tiny fraction of cases.
+        namespace grisu {
+
+            struct diyfp {
+                uint64_t f;
+                int e;
+
+                diyfp(uint64_t f_, int e_) : f(f_), e(e_) {}
+
+                static diyfp sub(const diyfp& x, const diyfp& y) { return diyfp(x.f - y.f, x.e); }
+
+                static diyfp mul(const diyfp& x, const diyfp& y) {
+                    uint64_t hi, lo;
+                    mul128(x.f, y.f, hi, lo);
+                    hi += lo >> 63;
+                    return diyfp(hi, x.e + y.e + 64);
+                }
+
+                static diyfp normalize(diyfp x) {
+                    int lz = static_cast<int>(clz64(x.f));
+                    return diyfp(x.f << lz, x.e - lz);
+                }
+
+                static diyfp normalize_to(const diyfp& x, int target) { return diyfp(x.f << (x.e - target), target); }
+            };
+
+            struct cached_power {
+                uint64_t f;
+                int e;
+                int k;
+            };
+
+            const int alpha = -60;
+            const int gamma = -32;
+
+            inline cached_power cached_power_for(int e) {
+                static const cached_power powers[] = {
+                    { 0xAB70FE17C79AC6CA, -1060, -300 },
+                    { 0xFF77B1FCBEBCDC4F, -1034, -292 },
+                    { 0xBE5691EF416BD60C, -1007, -284 },
+                    { 0x8DD01FAD907FFC3C,  -980, -276 },
+                    { 0xD3515C2831559A83,  -954, -268 },
+                    { 0x9D71AC8FADA6C9B5,  -927, -260 },
+                    { 0xEA9C227723EE8BCB,  -901, -252 },
+                    { 0xAECC49914078536D,  -874, -244 },
+                    { 0x823C12795DB6CE57,  -847, -236 },
+                    { 0xC21094364DFB5637,  -821, -228 },
+                    { 0x9096EA6F3848984F,  -794, -220 },
+                    { 0xD77485CB25823AC7,  -768, -212 },
+                    { 0xA086CFCD97BF97F4,  -741, -204 },
+                    { 0xEF340A98172AACE5,  -715, -196 },
+                    { 0xB23867FB2A35B28E,  -688, -188 },
+                    { 0x84C8D4DFD2C63F3B,  -661, -180 },
+                    { 0xC5DD44271AD3CDBA,  -635, -172 },
+                    { 0x936B9FCEBB25C996,  -608, -164 },
+                    { 0xDBAC6C247D62A584,  -582, -156 },
+                    { 0xA3AB66580D5FDAF6,  -555, -148 },
+                    { 0xF3E2F893DEC3F126,  -529, -140 },
+                    { 0xB5B5ADA8AAFF80B8,  -502, -132 },
+                    { 0x87625F056C7C4A8B,  -475, -124 },
+                    { 0xC9BCFF6034C13053,  -449, -116 },
+                    { 0x964E858C91BA2655,  -422, -108 },
+                    { 0xDFF9772470297EBD,  -396, -100 },
+                    { 0xA6DFBD9FB8E5B88F,  -369,  -92 },
+                    { 0xF8A95FCF88747D94,  -343,  -84 },
+                    { 0xB94470938FA89BCF,  -316,  -76 },
+                    { 0x8A08F0F8BF0F156B,  -289,  -68 },
+                    { 0xCDB02555653131B6,  -263,  -60 },
+                    { 0x993FE2C6D07B7FAC,  -236,  -52 },
+                    { 0xE45C10C42A2B3B06,  -210,  -44 },
+                    { 0xAA242499697392D3,  -183,  -36 },
+                    { 0xFD87B5F28300CA0E,  -157,  -28 },
+                    { 0xBCE5086492111AEB,  -130,  -20 },
+                    { 0x8CBCCC096F5088CC,  -103,  -12 },
+                    { 0xD1B71758E219652C,   -77,   -4 },
+                    { 0x9C40000000000000,   -50,    4 },
+                    { 0xE8D4A51000000000,   -24,   12 },
+                    { 0xAD78EBC5AC620000,     3,   20 },
+                    { 0x813F3978F8940984,    30,   28 },
+                    { 0xC097CE7BC90715B3,    56,   36 },
+                    { 0x8F7E32CE7BEA5C70,    83,   44 },
+                    { 0xD5D238A4ABE98068,   109,   52 },
+                    { 0x9F4F2726179A2245,   136,   60 },
+                    { 0xED63A231D4C4FB27,   162,   68 },
+                    { 0xB0DE65388CC8ADA8,   189,   76 },
+                    { 0x83C7088E1AAB65DB,   216,   84 },
+                    { 0xC45D1DF942711D9A,   242,   92 },
+                    { 0x924D692CA61BE758,   269,  100 },
+                    { 0xDA01EE641A708DEA,   295,  108 },
+                    { 0xA26DA3999AEF774A,   322,  116 },
+                    { 0xF209787BB47D6B85,   348,  124 },
+                    { 0xB454E4A179DD1877,   375,  132 },
+                    { 0x865B86925B9BC5C2,   402,  140 },
+                    { 0xC83553C5C8965D3D,   428,  148 },
+                    { 0x952AB45CFA97A0B3,   455,  156 },
+                    { 0xDE469FBD99A05FE3,   481,  164 },
+                    { 0xA59BC234DB398C25,   508,  172 },
+                    { 0xF6C69A72A3989F5C,   534,  180 },
+                    { 0xB7DCBF5354E9BECE,   561,  188 },
+                    { 0x88FCF317F22241E2,   588,  196 },
+                    { 0xCC20CE9BD35C78A5,   614,  204 },
+                    { 0x98165AF37B2153DF,   641,  212 },
+                    { 0xE2A0B5DC971F303A,   667,  220 },
+                    { 0xA8D9D1535CE3B396,   694,  228 },
+                    { 0xFB9B7CD9A4A7443C,   720,  236 },
+                    { 0xBB764C4CA7A44410,   747,  244 },
+                    { 0x8BAB8EEFB6409C1A,   774,  252 },
+                    { 0xD01FEF10A657842C,   800,  260 },
+                    { 0x9B10A4E5E9913129,   827,  268 },
+                    { 0xE7109BFBA19C0C9D,   853,  276 },
+                    { 0xAC2820D9623BF429,   880,  284 },
+                    { 0x80444B5E7AA7CF85,   907,  292 },
+                    { 0xBF21E44003ACDD2D,   933,  300 },
+                    { 0x8E679C2F5E44FF8F,   960,  308 },
+                    { 0xD433179D9C8CB841,   986,  316 },
+                    { 0x9E19DB92B4E31BA9,  1013,  324 },
+                };
+
+                const int f = alpha - e - 1;
+                const int k = (f * 78913) / (1 << 18) + static_cast<int>(f > 0);
+                const int index = (300 + k + 7) / 8;
+                return powers[index];
+            }
+
+            inline int largest_pow10(uint32_t n, uint32_t& pow10) {
+                static const uint32_t pows[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+                int k = 9;
+                while (k > 0 && n < pows[k]) --k;
+                pow10 = pows[k];
+                return k + 1;
+            }
+
+            inline void round(char* buf, int len, uint64_t dist, uint64_t delta, uint64_t rest, uint64_t ten_k) {
+                while (rest < dist && delta - rest >= ten_k && (rest + ten_k < dist || dist - rest > rest + ten_k - dist)) {
+                    buf[len - 1]--;
+                    rest += ten_k;
+                }
+            }
+
+            inline void digit_gen(char* buf, int& len, int& exp10, diyfp m_minus, diyfp w, diyfp m_plus) {
+                uint64_t delta = diyfp::sub(m_plus, m_minus).f;
+                uint64_t dist = diyfp::sub(m_plus, w).f;
+
+                const diyfp one(1ULL << -m_plus.e, m_plus.e);
+                uint32_t p1 = static_cast<uint32_t>(m_plus.f >> -one.e);
+                uint64_t p2 = m_plus.f & (one.f - 1);
+
+                uint32_t pow10;
+                int n = largest_pow10(p1, pow10);
+                while (n > 0) {
+                    uint32_t d = p1 / pow10;
+                    p1 %= pow10;
+                    buf[len++] = static_cast<char>('0' + d);
+                    --n;
+
+                    uint64_t rest = (static_cast<uint64_t>(p1) << -one.e) + p2;
+                    if (rest <= delta) {
+                        exp10 += n;
+                        round(buf, len, dist, delta, rest, static_cast<uint64_t>(pow10) << -one.e);
+                        return;
+                    }
+                    pow10 /= 10;
+                }
+
+                int m = 0;
+                for (;;) {
+                    p2 *= 10;
+                    uint64_t d = p2 >> -one.e;
+                    p2 &= one.f - 1;
+                    buf[len++] = static_cast<char>('0' + d);
+                    ++m;
+                    delta *= 10;
+                    dist *= 10;
+                    if (p2 <= delta) break;
+                }
+                exp10 -= m;
+                round(buf, len, dist, delta, p2, one.f);
+            }
+
+            // Shortest digits of a finite, positive value: value = buf[0, len) * 10^exp10.
+            inline void digits(double value, char* buf, int& len, int& exp10) {
+                const uint64_t bits = double_to_bits(value);
+                const uint64_t F = bits & ((1ULL << 52) - 1);
+                const int E = static_cast<int>(bits >> 52);
+
+                diyfp v = E == 0 ? diyfp(F, -1074) : diyfp(F + (1ULL << 52), E - 1075);
+                bool lower_closer = F == 0 && E > 1;
+                diyfp m_plus(2 * v.f + 1, v.e - 1);
+                diyfp m_minus = lower_closer ? diyfp(4 * v.f - 1, v.e - 2) : diyfp(2 * v.f - 1, v.e - 1);
+
+                diyfp w_plus = diyfp::normalize(m_plus);
+                diyfp w_minus = diyfp::normalize_to(m_minus, w_plus.e);
+                diyfp w = diyfp::normalize(v);
+
+                const cached_power c = cached_power_for(w_plus.e);
+                const diyfp c_minus_k(c.f, c.e);
+
+                diyfp sw = diyfp::mul(w, c_minus_k);
+                diyfp sw_minus = diyfp::mul(w_minus, c_minus_k);
+                diyfp sw_plus = diyfp::mul(w_plus, c_minus_k);
+
+                len = 0;
+                exp10 = -c.k;
+                digit_gen(buf, len, exp10, diyfp(sw_minus.f + 1, sw_minus.e), sw, diyfp(sw_plus.f - 1, sw_plus.e));
+            }
+
+        }
+
+        // Shortest round-trip form of value. Floats always keep a '.' or an exponent, so they read back
+        // as floats; non-finite values have no JSON form and are written as null.
+        inline size_t format_double(char* buf, double value) {
+            uint64_t bits = double_to_bits(value);
+            if (((bits >> 52) & 0x7FF) == 0x7FF) {
+                std::memcpy(buf, "null", 4);
+                return 4;
+            }
+
+            char* out = buf;
+            if (bits >> 63) {
+                *out++ = '-';
+                value = -value;
+            }
+            if (value == 0) {
+                std::memcpy(out, "0.0", 3);
+                return static_cast<size_t>(out + 3 - buf);
+            }
+
+            int k, exp10;
+            grisu::digits(value, out, k, exp10);
+            const int n = k + exp10;
+
+            if (k <= n && n <= 15) {
+                std::memset(out + k, '0', static_cast<size_t>(n - k));
+                out[n] = '.';
+                out[n + 1] = '0';
+                return static_cast<size_t>(out + n + 2 - buf);
+            }
+            if (0 < n && n <= 15) {
+                std::memmove(out + n + 1, out + n, static_cast<size_t>(k - n));
+                out[n] = '.';
+                return static_cast<size_t>(out + k + 1 - buf);
+            }
+            if (-4 < n && n <= 0) {
+                std::memmove(out + 2 - n, out, static_cast<size_t>(k));
+                out[0] = '0';
+                out[1] = '.';
+                std::memset(out + 2, '0', static_cast<size_t>(-n));
+                return static_cast<size_t>(out + 2 - n + k - buf);
+            }
+
+            if (k == 1) {
+                out += 1;
+            } else {
+                std::memmove(out + 2, out + 1, static_cast<size_t>(k - 1));
+                out[1] = '.';
+                out += k + 1;
+            }
+            *out++ = 'e';
+            int e = n - 1;
+            if (e < 0) {
+                *out++ = '-';
+                e = -e;
+            } else {
+                *out++ = '+';
+            }
+            out = write_uint(out, static_cast<uint64_t>(e));
+            return static_cast<size_t>(out - buf);
+        }
+
+        inline size_t format_int(char* buf, int64_t value) {
+            char* out = buf;
+            uint64_t u = static_cast<uint64_t>(value);
+            if (value < 0) {
+                *out++ = '-';
+                u = 0 - u;
+            }
+            return static_cast<size_t>(write_uint(out, u) - buf);
+        }
+
+        inline void write_number(Writer& out, int64_t value) {
+            char buf[24];
+            out.write(buf, format_int(buf, value));
+        }
+
+        inline void write_number(Writer& out, double value) {
+            char buf[40];
+            out.write(buf, format_double(buf, value));
+        }
+
+        inline size_t number_size(int64_t value) {
+            char buf[24];
+            return format_int(buf, value);
+        }
+
+        inline size_t number_size(double value) {
+            char buf[40];
+            return format_double(buf, value);
+        }
+
+        // Whether an integer fits the int64_t that JSONNumber and Value store. Unsigned values past
+        // INT64_MAX do not, and are kept as the nearest double instead of wrapping.
+        template <typename T>
+        inline bool fits_int64(T i) {
+            return std::is_signed<T>::value || static_cast<uint64_t>(i) <= static_cast<uint64_t>(INT64_MAX);
+        }
+
+    }
+
+    class JSONNumber : public JSONValue, public detail::Pooled<JSONNumber> {
+        NumberType num_type;
+        union {
+            double dbl;
+            int64_t integer;
+        } val;
+
+    public:
+        JSONNumber() : JSONValue(), num_type(NumberType::INTEGER) { val.integer = 0; }
+        JSONNumber(double d) : JSONValue(), num_type(NumberType::FLOAT) { val.dbl = d; }
+
+        template <typename T>
+        JSONNumber(T i, typename std::enable_if<std::is_integral<T>::value>::type* = 0) : JSONValue() {
+            if (detail::fits_int64(i)) {
+                num_type = NumberType::INTEGER;
+                val.integer = static_cast<int64_t>(i);
+            } else {
+                num_type = NumberType::FLOAT;
+                val.dbl = static_cast<double>(i);
+            }
+        }
+
+        NumberType number_type() const { return num_type; }
+
+        template <typename T>
+        T get() const {
+            return num_type == NumberType::FLOAT ? static_cast<T>(val.dbl) : static_cast<T>(val.integer);
+        }
+
+        ValueType type() const { return ValueType::NUMBER; }
+
+        void serialize(Writer& out) const {
+            if (num_type == NumberType::INTEGER) detail::write_number(out, val.integer);
+            else detail::write_number(out, val.dbl);
+        }
+
+        JSONNumber* create() const {
+            return new JSONNumber();
+        }
+
+        JSONNumber* clone() const {
+            return new JSONNumber(*this);
+        }
+
+    protected:
+        size_t measure(const Format&, size_t) const {
+            return num_type == NumberType::INTEGER ? detail::number_size(val.integer) : detail::number_size(val.dbl);
+        }
+    };
+
+    namespace detail {
+
+        // Fast non-cryptographic hash for object keys, eight bytes per step.
+        inline uint64_t hash_bytes(const char* data, size_t len) {
+            const uint64_t k = 0x9E3779B97F4A7C15ULL;
+            uint64_t h = len * k;
+            for (; len >= 8; data += 8, len -= 8) {
+                uint64_t v;
+                std::memcpy(&v, data, 8);
+                h = (h ^ v) * k;
+                h ^= h >> 29;
+            }
+            if (len) {
+                uint64_t v = 0;
+                std::memcpy(&v, data, len);
+                h = (h ^ v) * k;
+            }
+            h ^= h >> 32;
+            h *= k;
+            return h ^ (h >> 29);
+        }
+
+        inline uint32_t key_hash(const char* data, size_t len) {
+            return static_cast<uint32_t>(hash_bytes(data, len));
+        }
+
+    }
+
+    // A lookup key with its hash computed once, for field names that are looked up repeatedly.
+    // The characters are not copied and must outlive the Key.
+    class Key {
+        StringRef str;
+        uint32_t h;
+
+        Key(StringRef key, uint32_t hash) : str(key), h(hash) {}
+
+        friend class JSONPointer;
+
+    public:
+        explicit Key(StringRef key) : str(key), h(detail::key_hash(key.data(), key.size())) {}
+
+        const char* data() const { return str.data(); }
+        size_t size() const { return str.size(); }
+        uint32_t hash() const { return h; }
+    };
+
+    // Deduplicating string table for object keys. Each distinct key is stored once and handed out as a
+    // stable pointer, so documents parsed with the same pool share key bytes and lookups through a
+    // pooled Key usually match on pointer equality. A shared pool can be used from many threads at
+    // once; it is split into independently locked shards. The pool must outlive every tree using it.
+    class KeyPool {
+        struct Entry {
+            const char* ptr;
+            uint32_t len;
+            uint32_t hash;
+        };
+
+        struct Shard {
+            std::vector<Entry> table;
+            size_t count;
+            Arena bytes;
+            std::mutex lock;
+
+            Shard() : table(64), count(0), bytes(16384) {}
+
+            const char* intern(const char* str, size_t len, uint32_t hash) {
+                size_t mask = table.size() - 1;
+                size_t slot = (hash >> 4) & mask;
+                for (; table[slot].ptr; slot = (slot + 1) & mask) {
+                    const Entry& e = table[slot];
+                    if (e.hash == hash && e.len == len && std::memcmp(e.ptr, str, len) == 0) return e.ptr;
+                }
+
+                char* copy = static_cast<char*>(bytes.allocate(len ? len : 1, 1));
+                std::memcpy(copy, str, len);
+                Entry entry = {copy, static_cast<uint32_t>(len), hash};
+                table[slot] = entry;
+
+                if (2 * ++count > table.size()) grow();
+                return copy;
+            }
+
+            void grow() {
+                std::vector<Entry> next(table.size() * 2);
+                size_t mask = next.size() - 1;
+                for (const Entry& e : table) {
+                    if (!e.ptr) continue;
+                    size_t slot = (e.hash >> 4) & mask;
+                    while (next[slot].ptr) slot = (slot + 1) & mask;
+                    next[slot] = e;
+                }
+                table.swap(next);
+            }
+        };
+
+        bool shared;
+        std::vector<std::unique_ptr<Shard> > shards;
+
+        KeyPool(const KeyPool&);
+        KeyPool& operator=(const KeyPool&);
+
+    public:
+        explicit KeyPool(bool thread_safe = false) : shared(thread_safe) {
+            size_t n = thread_safe ? 16 : 1;
+            for (size_t i = 0; i < n; i++) shards.push_back(std::unique_ptr<Shard>(new Shard()));
+        }
+
+        // Returns the pooled copy of key, adding it on first use.
+        StringRef intern(StringRef key) {
+            if (key.size() > UINT32_MAX) throw std::length_error("jsonpp::KeyPool: key too long");
+
+            uint32_t hash = detail::key_hash(key.data(), key.size());
+            Shard& shard = *shards[hash & (shards.size() - 1)];
+            if (!shared) return StringRef(shard.intern(key.data(), key.size(), hash), key.size());
+
+            std::lock_guard<std::mutex> guard(shard.lock);
+            return StringRef(shard.intern(key.data(), key.size(), hash), key.size());
+        }
+
+        // A lookup Key backed by the pooled copy, so it matches pooled object keys by pointer.
+        Key key(StringRef str) { return Key(intern(str)); }
+
+        size_t size() {
+            size_t n = 0;
+            for (auto& shard : shards) {
+                if (shared) shard->lock.lock();
+                n += shard->count;
+                if (shared) shard->lock.unlock();
+            }
+            return n;
+        }
+    };
+
+    // Members are kept in insertion order in one flat vector. Small objects are searched linearly;
+    // above index_threshold members an open-addressing index of member positions is maintained too.
+    class JSONObject : public JSONValue, public detail::Pooled<JSONObject> {
+    public:
+        typedef std::pair<JSONString, JSONValue*> member;
+
+    private:
+        typedef std::vector<member, ArenaAllocator<member> > storage;
+
+        static const size_t index_threshold = 16;
+        static const size_t npos = static_cast<size_t>(-1);
+
+        storage values;
+
+        // Each slot holds a member position plus one (zero marks an empty slot) and that member's key
+        // hash, so probes reject most mismatches and rebuilds never rehash keys. Size is a power of two.
+        struct Slot {
+            uint32_t pos;
+            uint32_t hash;
+        };
+
+        std::vector<Slot, ArenaAllocator<Slot> > index;
+
+        void swap(JSONObject& that) {
+            require_mutable();
+            that.require_mutable();
+            std::swap(values, that.values);
+            std::swap(index, that.index);
+        }
+
+        static void index_insert(Slot* slots, size_t mask, uint32_t pos, uint32_t hash) {
+            size_t slot = hash & mask;
+            while (slots[slot].pos) slot = (slot + 1) & mask;
+            slots[slot].pos = pos;
+            slots[slot].hash = hash;
+        }
+
+        // Regrows the index, reusing the stored hashes of the first indexed members and hashing the rest.
+        void rebuild_index(size_t indexed) {
+            size_t slots = 2 * index_threshold;
+            while (slots < 2 * values.size()) slots *= 2;
+
+            std::vector<Slot, ArenaAllocator<Slot> > next(slots, Slot(), index.get_allocator());
+            for (const Slot& old : index) {
+                if (old.pos) index_insert(next.data(), slots - 1, old.pos, old.hash);
+            }
+            for (size_t i = indexed; i < values.size(); i++) {
+                const JSONString& k = values[i].first;
+                index_insert(next.data(), slots - 1, static_cast<uint32_t>(i + 1), detail::key_hash(k.data(), k.size()));
+            }
+            index.swap(next);
+        }
+
+        // Interned keys (see KeyPool) usually match on the pointer alone.
+        static bool same_key(const JSONString& k, const char* key, size_t len) {
+            return k.size() == len && (k.data() == key || std::memcmp(k.data(), key, len) == 0);
+        }
+
+        size_t scan(const char* key, size_t len) const {
+            for (size_t i = 0; i < values.size(); i++) {
+                if (same_key(values[i].first, key, len)) return i;
+            }
+            return npos;
+        }
+
+        size_t probe(const char* key, size_t len, uint32_t hash) const {
+            size_t mask = index.size() - 1;
+            for (size_t slot = hash & mask; index[slot].pos; slot = (slot + 1) & mask) {
+                if (index[slot].hash == hash && same_key(values[index[slot].pos - 1].first, key, len)) {
+                    return index[slot].pos - 1;
+                }
+            }
+            return npos;
+        }
+
+        size_t find_pos(StringRef key) const {
+            if (index.empty()) return scan(key.data(), key.size());
+            return probe(key.data(), key.size(), detail::key_hash(key.data(), key.size()));
+        }
+
+        size_t find_pos(const Key& key) const {
+            if (index.empty()) return scan(key.data(), key.size());
+            return probe(key.data(), key.size(), key.hash());
+        }
+
+        // Unlinks the member at pos and returns its value. Later positions shift, so the index is rebuilt.
+        JSONValue* remove(size_t pos) {
+            JSONValue* node = values[pos].second;
+            values.erase(values.begin() + pos);
+            index.clear();
+            if (values.size() > index_threshold) rebuild_index(0);
+            return node;
+        }
+
+        // Appends a member whose key is known to be absent.
+        void append(JSONString&& key, JSONValue* value) {
+            values.push_back(member(std::move(key), value));
+
+            if (values.size() > index_threshold) {
+                if (2 * values.size() > index.size()) {
+                    rebuild_index(index.empty() ? 0 : values.size() - 1);
+                } else {
+                    const JSONString& k = values.back().first;
+                    index_insert(index.data(), index.size() - 1, static_cast<uint32_t>(values.size()),
+                                 detail::key_hash(k.data(), k.size()));
+                }
+            }
+        }
+
+    protected:
+        void release_children(std::vector<JSONValue*>& out) {
+            for (auto& pa : values) {
+                out.push_back(pa.second);
+            }
+            values.clear();
+            index.clear();
+        }
+
+        size_t measure(const Format& format, size_t level) const {
+            size_t n = detail::layout_size(format, level, values.size(), true);
+            for (const member& pa : values) {
+                n += escaped_size(pa.first.data(), pa.first.size(), format.ascii) + 2 + detail::measure(*pa.second, format, level + 1);
+            }
+            return n;
+        }
+
+        JSONValue* share() const { return share_container(arena() != nullptr); }
+
+    public:
+        JSONObject() : JSONValue() {}
+
+        // An arena-backed object keeps its storage in arena, and its members are expected to live there too.
+        explicit JSONObject(Arena* arena)
+                : JSONValue(), values(ArenaAllocator<member>(arena)), index(ArenaAllocator<uint32_t>(arena)) {}
+
+        template <typename InputIterator>
+        JSONObject(InputIterator begin, InputIterator end): JSONValue() {
+            for (; begin != end; ++begin) insert(begin->first, begin->second);
+        }
+
+        // Like JSONArray's, a copy of a heap object shares nested containers; positions and hashes are the
+        // same, so the index is copied as is.
+        JSONObject(const JSONObject& that) : JSONValue() {
+            values.reserve(that.values.size());
+            for (auto& pa : that.values) {
+                values.push_back(member(pa.first, that.arena() ? pa.second->clone() : detail::share(*pa.second)));
+            }
+            index.assign(that.index.begin(), that.index.end());
+        }
+
+        // Takes over the members, index and arena of that, leaving it empty. Like JSONArray's, refuses a
+        // frozen or shared that, leaving this empty.
+        JSONObject(JSONObject&& that) noexcept : JSONValue() {
+            if (that.movable()) swap(that);
+        }
+
+        // Iteration follows insertion order. Members are observed only; the object keeps ownership, so
+        // they change through insert(), take() and erase(). Values reached by iteration or the const
+        // operator[] may be shared with copies of this object and must not be modified.
+        typedef storage::const_iterator iterator;
+        typedef iterator const_iterator;
+
+        const_iterator begin() const { return values.begin(); }
+        const_iterator end() const { return values.end(); }
+
+        // Lookups accept anything convertible to StringRef, or a Key with a precomputed hash; neither
+        // allocates. Objects above index_threshold members answer in O(1) expected time.
+        const_iterator find(StringRef key) const {
+            size_t pos = find_pos(key);
+            return pos == npos ? values.end() : values.begin() + pos;
+        }
+
+        const_iterator find(const Key& key) const {
+            size_t pos = find_pos(key);
+            return pos == npos ? values.end() : values.begin() + pos;
+        }
+
+        // Throws std::out_of_range for a missing key; use find() or contains() to test first.
+        const JSONValue* operator[](StringRef index) const {
+            size_t pos = find_pos(index);
+            if (pos == npos) throw std::out_of_range("jsonpp::JSONObject: no such key");
+            return values[pos].second;
+        }
+
+        const JSONValue* operator[](const Key& index) const {
+            size_t pos = find_pos(index);
+            if (pos == npos) throw std::out_of_range("jsonpp::JSONObject: no such key");
+            return values[pos].second;
+        }
+
+        // A value that may be modified: if it is shared, it is first replaced by a private copy.
+        JSONValue* operator[](StringRef index) {
+            require_mutable();
+            size_t pos = find_pos(index);
+            if (pos == npos) throw std::out_of_range("jsonpp::JSONObject: no such key");
+            return arena() ? values[pos].second : detail::unshare(values[pos].second);
+        }
+
+        JSONValue* operator[](const Key& index) {
+            require_mutable();
+            size_t pos = find_pos(index);
+            if (pos == npos) throw std::out_of_range("jsonpp::JSONObject: no such key");
+            return arena() ? values[pos].second : detail::unshare(values[pos].second);
+        }
+
+        bool contains(StringRef key) const { return find_pos(key) != npos; }
+        bool contains(const Key& key) const { return find_pos(key) != npos; }
+        size_t size() const {return values.size(); }
+
+        // Takes ownership of value, replacing (and deleting) any existing member with the same key unless
+        // it is value itself.
+        void insert(const JSONString& key, JSONValue* value) {
+            insert(JSONString(key), value);
+        }
+
+        void insert(JSONString&& key, JSONValue* value) {
+            require_mutable();
+            value = detail::or_null(value, arena());
+            size_t pos = find_pos(StringRef(key.data(), key.size()));
+            if (pos == npos) {
+                append(std::move(key), value);
+                return;
+            }
+
+            if (values[pos].second == value) return;
+            if (!arena()) detail::release(values[pos].second);
+            values[pos].second = value;
+        }
+
+        void insert(StringRef key, JSONValue* value) { insert(JSONString(key.data(), key.size(), arena()), value); }
+
+        template <typename T>
+        void insert(StringRef key, std::unique_ptr<T> value) { insert(key, static_cast<JSONValue*>(value.release())); }
+
+        // Removes a member and hands its value to the caller; empty if there is no such key.
+        NodePtr take(StringRef key) {
+            require_mutable();
+            size_t pos = find_pos(key);
+            if (pos == npos) return NodePtr();
+            if (!arena()) detail::unshare(values[pos].second);
+            return detail::adopt(remove(pos), arena());
+        }
+
+        bool erase(StringRef key) {
+            require_mutable();
+            size_t pos = find_pos(key);
+            if (pos == npos) return false;
+
+            JSONValue* node = remove(pos);
+            if (!arena()) detail::release(node);
+            return true;
+        }
+
+        // Moves (or copies) node into a new member allocated where the object's storage is.
+        template <typename T, typename = typename std::enable_if<std::is_base_of<JSONValue, typename std::decay<T>::type>::value>::type>
+        void insert(StringRef key, T&& node) {
+            insert(JSONString(key.data(), key.size(), arena()),
+                   detail::make<typename std::decay<T>::type>(arena(), std::forward<T>(node)));
+        }
+
+        // Constructs a member value in place and returns it, replacing any existing member with that key.
+        // In an arena-backed object, pass the arena to nodes that have storage of their own.
+        template <typename T, typename... Args>
+        T* emplace(StringRef key, Args&&... args) {
+            require_mutable();
+            T* node = detail::make<T>(arena(), std::forward<Args>(args)...);
+            insert(JSONString(key.data(), key.size(), arena()), node);
+            return node;
+        }
+
+        Arena* arena() const { return values.get_allocator().arena(); }
+
+        ValueType type() const { return ValueType::OBJECT; }
+
+        JSONObject& operator=(const JSONObject& that) {
+            require_mutable();
+            JSONObject copy(that);
+            swap(copy);
+            return *this;
+        }
+
+        // The previous members are released before returning; as for JSONArray, neither side may be
+        // frozen or shared.
+        JSONObject& operator=(JSONObject&& that) {
+            require_mutable();
+            that.require_mutable();
+            JSONObject old(std::move(that));
+            swap(old);
+            return *this;
+        }
+
+        JSONObject* create() const {
+            return new JSONObject();
+        }
+
+        JSONObject* clone() const {
+            return new JSONObject(*this);
+        }
+
+        ~JSONObject() {
+            if (!arena()) detail::destroy_children(this);
+        }
+
+        void serialize(Writer& out) const {
+            out.open('{');
+
+            for (const_iterator it = values.begin(); it != values.end(); ++it) {
+                out.separator(it == values.begin());
+                it->first.serialize(out);
+                out.key_separator();
+                it->second->serialize(out);
+            }
+
+            out.close('}', values.empty());
+        }
+
+    };
+
+    // A 16-byte tagged value. Null, booleans, numbers and strings of up to 14 bytes are stored inline;
+    // longer strings and nested containers are held through a pointer. Unlike JSONValue nodes, Values
+    // can be stored contiguously, which is what JSONCompactArray does.
+    class Value {
+        enum Kind {
+            NIL,
+            BOOL,
+            INTEGER,
+            FLOAT,
+            SHORT_STRING,
+            STRING,
+            NODE
+        };
+
+        // Set on STRING and NODE payloads that this Value does not own (arena or caller storage).
+        static const unsigned char borrowed_bit = 0x80;
+        static const size_t short_capacity = 14;
+
+        // [0, 8) payload, [8, 12) string length, [0, 14) inline string bytes, 14 inline length, 15 tag.
+        alignas(8) unsigned char bytes[16];
+
+        template <typename T>
+        T load() const {
+            T v;
+            std::memcpy(&v, bytes, sizeof(T));
+            return v;
+        }
+
+        template <typename T>
+        void store(T v) { std::memcpy(bytes, &v, sizeof(T)); }
+
+        Kind kind() const { return static_cast<Kind>(bytes[15] & ~borrowed_bit); }
+        bool owned() const { return !(bytes[15] & borrowed_bit); }
+        void set_kind(Kind k, bool borrowed = false) { bytes[15] = static_cast<unsigned char>(k | (borrowed ? borrowed_bit : 0)); }
+
+        uint32_t long_size() const {
+            uint32_t n;
+            std::memcpy(&n, bytes + 8, sizeof(n));
+            return n;
+        }
+
+        void set_string(const char* str, size_t len, Arena* arena) {
+            if (len <= short_capacity) {
+                std::memcpy(bytes, str, len);
+                bytes[14] = static_cast<unsigned char>(len);
+                set_kind(SHORT_STRING);
+                return;
+            }
+
+            if (len > UINT32_MAX) throw std::length_error("jsonpp::Value: string too long");
+
+            if (!arena) JSONPP_INSTRUMENT(on_allocate(len));
+            char* copy = arena ? static_cast<char*>(arena->allocate(len, 1)) : new char[len];
+            std::memcpy(copy, str, len);
+            store<const char*>(copy);
+            uint32_t n = static_cast<uint32_t>(len);
+            std::memcpy(bytes + 8, &n, sizeof(n));
+            set_kind(STRING, arena != nullptr);
+        }
+
+        void release() {
+            if (!owned()) return;
+            if (kind() == STRING) delete[] load<const char*>();
+            else if (kind() == NODE) detail::release(load<JSONValue*>());
+        }
+
+        friend class JSONCompactArray;
+
+    public:
+        Value() { set_kind(NIL); }
+        Value(bool b) { store(b); set_kind(BOOL); }
+        Value(double d) { store(d); set_kind(FLOAT); }
+
+        template <typename T>
+        Value(T i, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type* = 0) {
+            if (detail::fits_int64(i)) {
+                store(static_cast<int64_t>(i));
+                set_kind(INTEGER);
+            } else {
+                store(static_cast<double>(i));
+                set_kind(FLOAT);
+            }
+        }
+
+        // Copies the string; with an arena, long strings are copied into it and borrowed.
+        Value(const char* str, size_t len, Arena* arena = nullptr) { set_string(str, len, arena); }
+        Value(const std::string& str) { set_string(str.data(), str.size(), nullptr); }
+
+        // A string Value that refers to [str, str + len) without copying it; the bytes must outlive it.
+        // Short strings are still stored inline.
+        static Value view(const char* str, size_t len) {
+            if (len <= short_capacity || len > UINT32_MAX) return Value(str, len);
+
+            Value out;
+            out.store(str);
+            uint32_t n = static_cast<uint32_t>(len);
+            std::memcpy(out.bytes + 8, &n, sizeof(n));
+            out.set_kind(STRING, true);
+            return out;
+        }
+
+        // Holds a node. Owned nodes are deleted with the Value; borrowed ones must outlive it.
+        explicit Value(JSONValue* node, bool owned = true) {
+            store(node);
+            set_kind(NODE, !owned);
+        }
+
+        Value(const Value& that) {
+            switch (that.kind()) {
+                case STRING: set_string(that.data(), that.size(), nullptr); break;
+                case NODE:
+                    store(detail::share(*that.node()));
+                    set_kind(NODE);
+                    break;
+                default:
+                    std::memcpy(bytes, that.bytes, sizeof(bytes));
+                    set_kind(that.kind());
+                    break;
+            }
+        }
+
+        Value(Value&& that) noexcept {
+            std::memcpy(bytes, that.bytes, sizeof(bytes));
+            that.set_kind(NIL);
+        }
+
+        Value& operator=(const Value& that) { return *this = Value(that); }
+
+        Value& operator=(Value&& that) noexcept {
+            if (this != &that) {
+                release();
+                std::memcpy(bytes, that.bytes, sizeof(bytes));
+                that.set_kind(NIL);
+            }
+            return *this;
+        }
+
+        ~Value() { release(); }
+
+        ValueType type() const {
+            switch (kind()) {
+                case NIL: return ValueType::NULL_TYPE;
+                case BOOL: return ValueType::BOOLEAN;
+                case INTEGER:
+                case FLOAT: return ValueType::NUMBER;
+                case SHORT_STRING:
+                case STRING: return ValueType::STRING;
+                default: return node()->type();
+            }
+        }
+
+        bool boolean() const { return kind() == BOOL && load<bool>(); }
+
+        NumberType number_type() const { return kind() == FLOAT ? NumberType::FLOAT : NumberType::INTEGER; }
+
+        template <typename T>
+        T number() const {
+            if (kind() == FLOAT) return static_cast<T>(load<double>());
+            if (kind() == INTEGER) return static_cast<T>(load<int64_t>());
+            return T();
+        }
+
+        const char* data() const {
+            if (kind() == SHORT_STRING) return reinterpret_cast<const char*>(bytes);
+            if (kind() == STRING) return load<const char*>();
+            return "";
+        }
+
+        size_t size() const {
+            if (kind() == SHORT_STRING) return bytes[14];
+            if (kind() == STRING) return long_size();
+            return 0;
+        }
+
+        std::string str() const { return std::string(data(), size()); }
+
+        // The held node for arrays and objects, or nullptr for inline values.
+        JSONValue* node() const { return kind() == NODE ? load<JSONValue*>() : nullptr; }
+
+        void serialize(Writer& out) const {
+            switch (kind()) {
+                case NIL: out.write("null", 4); break;
+                case BOOL:
+                    if (load<bool>()) out.write("true", 4);
+                    else out.write("false", 5);
+                    break;
+                case INTEGER: detail::write_number(out, load<int64_t>()); break;
+                case FLOAT: detail::write_number(out, load<double>()); break;
+                case SHORT_STRING:
+                case STRING:
+                    out.put('"');
+                    escape_str(data(), size(), out);
+                    out.put('"');
+                    break;
+                case NODE: node()->serialize(out); break;
+            }
+        }
+
+        // Exact length of serialize()'s output in format, starting level containers deep.
+        size_t serialized_size(const Format& format = Format(), size_t level = 0) const {
+            switch (kind()) {
+                case NIL: return 4;
+                case BOOL: return load<bool>() ? 4 : 5;
+                case INTEGER: return detail::number_size(load<int64_t>());
+                case FLOAT: return detail::number_size(load<double>());
+                case SHORT_STRING:
+                case STRING: return escaped_size(data(), size(), format.ascii) + 2;
+                case NODE: return detail::measure(*node(), format, level);
+            }
+            return 0;
+        }
+    };
+
+    // Array of Values stored inline. Scalars cost 16 bytes each and iteration is a linear scan,
+    // instead of one pointer and one heap node per element as in JSONArray.
+    class JSONCompactArray : public JSONValue, public detail::Pooled<JSONCompactArray> {
+
+        std::vector<Value, ArenaAllocator<Value> > values;
+
+        void swap(JSONCompactArray& that) {
+            require_mutable();
+            that.require_mutable();
+            std::swap(this->values, that.values);
+        }
+
+    protected:
+        void release_children(std::vector<JSONValue*>& out) {
+            for (Value& v : values) {
+                if (v.kind() == Value::NODE && v.owned()) {
+                    out.push_back(v.node());
+                    v.set_kind(Value::NIL);
+                }
+            }
+            values.clear();
+        }
+
+        size_t measure(const Format& format, size_t level) const {
+            size_t n = detail::layout_size(format, level, values.size(), false);
+            for (const Value& v : values) n += v.serialized_size(format, level + 1);
+            return n;
+        }
+
+        JSONValue* share() const { return share_container(arena() != nullptr); }
+
+    public:
+        JSONCompactArray() : JSONValue() {}
+
+        explicit JSONCompactArray(Arena* arena) : JSONValue(), values(ArenaAllocator<Value>(arena)) {}
+
+        explicit JSONCompactArray(const JSONArray& that) {
+            values.reserve(that.size());
+            for (const JSONValue* v : that) push_back(*v);
+        }
+
+        // Copies scalars and long strings; nested containers are shared as in JSONArray's copy.
+        JSONCompactArray(const JSONCompactArray& that) : JSONValue() {
+            values.reserve(that.size());
+            for (const Value& v : that.values) {
+                if (that.arena() && v.kind() == Value::NODE) values.push_back(Value(v.node()->clone()));
+                else values.push_back(v);
+            }
+        }
+
+        // Like JSONArray's, refuses a frozen or shared that, leaving this empty.
+        JSONCompactArray(JSONCompactArray&& that) noexcept : JSONValue() {
+            if (that.movable()) values.swap(that.values);
+        }
+
+        // Like JSONArray's, elements are only observed through iterators: containers they hold may be
+        // shared with copies of this array, so modify elements through operator[].
+        typedef std::vector<Value, ArenaAllocator<Value> >::const_iterator iterator;
+        typedef iterator const_iterator;
+
+        const_iterator begin() const { return values.begin(); }
+        const_iterator end() const { return values.end(); }
+
+        // An element that may be modified: a shared container it holds is first replaced by a private copy.
+        Value& operator[](size_t index) {
+            require_mutable();
+            Value& v = values[index];
+            if (v.kind() == Value::NODE && v.owned()) {
+                JSONValue* node = v.node();
+                v.store(detail::unshare(node));
+            }
+            return v;
+        }
+
+        const Value& operator[](size_t index) const { return values[index]; }
+
+        size_t size() const {return values.size(); }
+
+        void reserve(size_t n) { values.reserve(n); }
+
+        void push_back(Value value) {
+            require_mutable();
+            values.push_back(std::move(value));
+        }
+
+        // Stores a copy of node: scalars inline, containers shared with node's other parents.
+        void push_back(const JSONValue& node) {
+            require_mutable();
+            switch (node.type()) {
+                case ValueType::NULL_TYPE: values.push_back(Value()); break;
+                case ValueType::BOOLEAN: values.push_back(Value(static_cast<const JSONBooleanType&>(node).get())); break;
+                case ValueType::NUMBER: {
+                    const JSONNumber& n = static_cast<const JSONNumber&>(node);
+                    if (n.number_type() == NumberType::INTEGER) values.push_back(Value(n.get<int64_t>()));
+                    else values.push_back(Value(n.get<double>()));
+                    break;
+                }
+                case ValueType::STRING: {
+                    const JSONString& str = static_cast<const JSONString&>(node);
+                    values.push_back(Value(str.data(), str.size(), arena()));
+                    break;
+                }
+                default: values.push_back(Value(detail::share(node))); break;
+            }
+        }
+
+        Arena* arena() const { return values.get_allocator().arena(); }
+
+        JSONCompactArray& operator=(const JSONCompactArray& that) {
+            require_mutable();
+            JSONCompactArray copy(that);
+            swap(copy);
+            return *this;
+        }
+
+        JSONCompactArray& operator=(JSONCompactArray&& that) {
+            require_mutable();
+            that.require_mutable();
+            JSONCompactArray old(std::move(that));
+            swap(old);
+            return *this;
+        }
+
+        ValueType type() const { return ValueType::ARRAY; }
+
+        JSONCompactArray* create() const {
+            return new JSONCompactArray();
+        }
+
+        JSONCompactArray* clone() const {
+            return new JSONCompactArray(*this);
+        }
+
+        ~JSONCompactArray() {
+            if (!arena()) detail::destroy_children(this);
+        }
+
+        void serialize(Writer& out) const {
+            out.open('[');
+
+            for (const_iterator it = values.begin(); it != values.end(); ++it) {
+                out.separator(it == values.begin());
+                it->serialize(out);
+            }
+
+            out.close(']', values.empty());
+        }
+
+    };
+
+    // Frees the node blocks the calling thread keeps cached for reuse, e.g. after a large document
+    // has been destroyed. Threads release their caches automatically when they exit.
+    inline void trim_node_pools() {
+        detail::NodePool<JSONNullType>::trim();
+        detail::NodePool<JSONBooleanType>::trim();
+        detail::NodePool<JSONNumber>::trim();
+        detail::NodePool<JSONString>::trim();
+        detail::NodePool<JSONArray>::trim();
+        detail::NodePool<JSONObject>::trim();
+        detail::NodePool<JSONCompactArray>::trim();
+    }
+
+    // Marks root and every node below it frozen and returns it. A frozen tree can be read from any number
+    // of threads without locking: const access never writes to a node, and every mutator throws
+    // std::logic_error instead; so does move assignment into or out of a frozen container, and move
+    // construction from one takes nothing. Freeze a tree before other threads can see it. To change one,
+    // copy it; the copy shares the frozen subtrees and copies them only on the path that is modified.
+    // Subtrees root still shares with copies of it are replaced by private copies first, so freezing never
+    // writes to a node another tree can reach. Throws std::logic_error if root itself is shared.
+    inline const JSONValue* freeze(JSONValue* root) {
+        if (root->shared() && !root->frozen()) throw std::logic_error("jsonpp: cannot freeze a shared node");
+
+        std::vector<JSONValue*> pending(1, root);
+        while (!pending.empty()) {
+            JSONValue* node = pending.back();
+            pending.pop_back();
+            // Frozen subtrees, e.g. ones shared with an earlier frozen tree, are frozen throughout.
+            if (node->frozen()) continue;
+
+            // Children are made private while node can still replace them, then node is frozen.
+            switch (node->type()) {
+                case ValueType::OBJECT: {
+                    JSONObject* obj = static_cast<JSONObject*>(node);
+                    for (const JSONObject::member& pa : *obj) {
+                        JSONValue* child = pa.second;
+                        if (child->shared() && !child->frozen()) child = (*obj)[StringRef(pa.first.data(), pa.first.size())];
+                        pending.push_back(child);
+                    }
+                    break;
+                }
+                case ValueType::ARRAY:
+                    if (JSONCompactArray* compact = dynamic_cast<JSONCompactArray*>(node)) {
+                        const JSONCompactArray& view = *compact;
+                        for (size_t i = 0; i < view.size(); i++) {
+                            JSONValue* child = view[i].node();
+                            if (!child) continue;
+                            if (child->shared() && !child->frozen()) child = (*compact)[i].node();
+                            pending.push_back(child);
+                        }
+                    } else {
+                        JSONArray* arr = static_cast<JSONArray*>(node);
+                        const JSONArray& view = *arr;
+                        for (size_t i = 0; i < view.size(); i++) {
+                            const JSONValue* child = view[i];
+                            pending.push_back(child->shared() && !child->frozen() ? (*arr)[i] : const_cast<JSONValue*>(child));
+                        }
+                    }
+                    break;
+                default:
+                    break;
+            }
+            detail::mark_frozen(node);
+        }
+        return root;
+    }
+
+    // Resource limits for untrusted input; zero leaves a limit off. A parse that goes over one stops
+    // there with a parse_error positioned at the offending value, before anything more is allocated.
+    struct ParseLimits {
+        // Containers open at once.
+        size_t max_depth;
+
+        // Length of the whole input.
+        size_t max_bytes;
+
+        // Length of any string or key, after unescaping.
+        size_t max_string_length;
+
+        // Elements of an array or members of an object.
+        size_t max_members;
+
+        // Values of every kind in the document, containers included.
+        size_t max_nodes;
+
+        ParseLimits() : max_depth(0), max_bytes(0), max_string_length(0), max_members(0), max_nodes(0) {}
+    };
+
+    struct ParseOptions {
+        // Build arrays as JSONCompactArray, storing scalar elements inline instead of as nodes.
+        bool compact_arrays;
+
+        // Intern object keys into this pool instead of giving every object its own copy.
+        KeyPool* key_pool;
+
+        // Store strings without escapes as views into the input buffer rather than copies. The buffer
+        // must then outlive the parsed tree; only strings containing escapes are materialized.
+        bool borrow_strings;
+
+        ParseLimits limits;
+
+        // Reject strings that are not well-formed UTF-8, or that escape half of a surrogate pair.
+        // Validation runs over each string as it is scanned; turning it off accepts the bytes as given.
+        bool validate_utf8;
+
+        // Find where each token starts with the SIMD structural indexer, in one pass over the input ahead
+        // of parsing, rather than stepping over whitespace a byte at a time. The result is the same. The
+        // extra pass costs more than it saves on compact input, so this is off by default.
+        bool indexed;
+
+        ParseOptions()
+                : compact_arrays(false), key_pool(nullptr), borrow_strings(false), validate_utf8(true), indexed(false) {}
+    };
+
+    namespace detail {
+
+        // Stage 1 of structural indexing. Each 64-byte block is classified into one bit per byte for
+        // backslashes, quotes, whitespace and the operators { } [ ] : , and the masks are then combined
+        // without branching into the positions a parser has to stop at.
+        struct BlockMasks {
+            uint64_t backslash;
+            uint64_t quote;
+            uint64_t ws;
+            uint64_t op;
+        };
+
+        typedef void (*classify_fn)(const unsigned char* block, BlockMasks& m);
+
+        inline void classify_scalar(const unsigned char* b, BlockMasks& m) {
+            m.backslash = m.quote = m.ws = m.op = 0;
+            for (unsigned i = 0; i < 64; i++) {
+                uint64_t bit = uint64_t(1) << i;
+                unsigned char c = b[i];
+                unsigned char folded = c | 0x20;
+                if (c == '\\') m.backslash |= bit;
+                else if (c == '"') m.quote |= bit;
+                else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') m.ws |= bit;
+                else if (folded == '{' || folded == '}' || c == ':' || c == ',') m.op |= bit;
+            }
+        }
+
+        // ORing in 0x20 folds '[' onto '{' and ']' onto '}', so four compares find all six operators.
+#if defined(JSONPP_SSE2)
+        inline void classify_sse2(const unsigned char* b, BlockMasks& m) {
+            const __m128i lower = _mm_set1_epi8(0x20);
+            m.backslash = m.quote = m.ws = m.op = 0;
+            for (unsigned i = 0; i < 4; i++) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 16 * i));
+                __m128i f = _mm_or_si128(v, lower);
+                __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                                          _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+                __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(f, _mm_set1_epi8('{')), _mm_cmpeq_epi8(f, _mm_set1_epi8('}'))),
+                                          _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')), _mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+                unsigned shift = 16 * i;
+                m.backslash |= uint64_t(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))))) << shift;
+                m.quote |= uint64_t(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))))) << shift;
+                m.ws |= uint64_t(static_cast<uint32_t>(_mm_movemask_epi8(ws))) << shift;
+                m.op |= uint64_t(static_cast<uint32_t>(_mm_movemask_epi8(op))) << shift;
+            }
+        }
+#endif
+
+#if defined(JSONPP_AVX2) || defined(JSONPP_DISPATCH)
+        JSONPP_TARGET("avx2") inline void classify_avx2(const unsigned char* b, BlockMasks& m) {
+            const __m256i lower = _mm256_set1_epi8(0x20);
+            m.backslash = m.quote = m.ws = m.op = 0;
+            for (unsigned i = 0; i < 2; i++) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + 32 * i));
+                __m256i f = _mm256_or_si256(v, lower);
+                __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                                             _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+                __m256i op = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(f, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(f, _mm256_set1_epi8('}'))),
+                                             _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+                unsigned shift = 32 * i;
+                m.backslash |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))))) << shift;
+                m.quote |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))))) << shift;
+                m.ws |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(ws))) << shift;
+                m.op |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(op))) << shift;
+            }
+        }
+#endif
+
+#if defined(__AVX512BW__) || defined(JSONPP_DISPATCH)
+        JSONPP_TARGET("avx512bw") inline void classify_avx512(const unsigned char* b, BlockMasks& m) {
+            __m512i v = _mm512_loadu_si512(b);
+            __m512i f = _mm512_or_si512(v, _mm512_set1_epi8(0x20));
+            m.backslash = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\\'));
+            m.quote = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('"'));
+            m.ws = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(' ')) | _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\t')) |
+                   _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\n')) | _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\r'));
+            m.op = _mm512_cmpeq_epi8_mask(f, _mm512_set1_epi8('{')) | _mm512_cmpeq_epi8_mask(f, _mm512_set1_epi8('}')) |
+                   _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(':')) | _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(','));
+        }
+#endif
+
+#if defined(JSONPP_NEON)
+        // Gathers the top bit of each byte of four compare results into a 64-bit mask.
+        inline uint64_t neon_movemask(uint8x16_t a, uint8x16_t b, uint8x16_t c, uint8x16_t d) {
+            static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+            const uint8x16_t w = vld1q_u8(weights);
+            uint8x16_t ab = vpaddq_u8(vandq_u8(a, w), vandq_u8(b, w));
+            uint8x16_t cd = vpaddq_u8(vandq_u8(c, w), vandq_u8(d, w));
+            uint8x16_t all = vpaddq_u8(ab, cd);
+            all = vpaddq_u8(all, all);
+            return vgetq_lane_u64(vreinterpretq_u64_u8(all), 0);
+        }
+
+        inline void classify_neon(const unsigned char* b, BlockMasks& m) {
+            uint8x16_t bs[4], qt[4], ws[4], op[4];
+            for (unsigned i = 0; i < 4; i++) {
+                uint8x16_t v = vld1q_u8(b + 16 * i);
+                uint8x16_t f = vorrq_u8(v, vdupq_n_u8(0x20));
+                bs[i] = vceqq_u8(v, vdupq_n_u8('\\'));
+                qt[i] = vceqq_u8(v, vdupq_n_u8('"'));
+                ws[i] = vorrq_u8(vorrq_u8(vceqq_u8(v, vdupq_n_u8(' ')), vceqq_u8(v, vdupq_n_u8('\t'))),
+                                 vorrq_u8(vceqq_u8(v, vdupq_n_u8('\n')), vceqq_u8(v, vdupq_n_u8('\r'))));
+                op[i] = vorrq_u8(vorrq_u8(vceqq_u8(f, vdupq_n_u8('{')), vceqq_u8(f, vdupq_n_u8('}'))),
+                                 vorrq_u8(vceqq_u8(v, vdupq_n_u8(':')), vceqq_u8(v, vdupq_n_u8(','))));
+            }
+            m.backslash = neon_movemask(bs[0], bs[1], bs[2], bs[3]);
+            m.quote = neon_movemask(qt[0], qt[1], qt[2], qt[3]);
+            m.ws = neon_movemask(ws[0], ws[1], ws[2], ws[3]);
+            m.op = neon_movemask(op[0], op[1], op[2], op[3]);
+        }
+#endif
+
+        // The widest classifier this build and CPU support, chosen once.
+        inline classify_fn structural_kernel() {
+#if defined(JSONPP_DISPATCH)
+            static const classify_fn fn = [] {
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx512bw")) return &classify_avx512;
+                if (__builtin_cpu_supports("avx2")) return &classify_avx2;
+#  if defined(JSONPP_SSE2)
+                return &classify_sse2;
+#  else
+                return &classify_scalar;
+#  endif
+            }();
+            return fn;
+#elif defined(__AVX512BW__)
+            return &classify_avx512;
+#elif defined(JSONPP_AVX2)
+            return &classify_avx2;
+#elif defined(JSONPP_SSE2)
+            return &classify_sse2;
+#elif defined(JSONPP_NEON)
+            return &classify_neon;
+#else
+            return &classify_scalar;
+#endif
+        }
+
+        // Carries string and escape state from block to block.
+        class StructuralScanner {
+            uint64_t prev_escaped;
+            uint64_t prev_in_string;
+            uint64_t prev_scalar;
+
+            static uint64_t prefix_xor(uint64_t x) {
+                x ^= x << 1;
+                x ^= x << 2;
+                x ^= x << 4;
+                x ^= x << 8;
+                x ^= x << 16;
+                x ^= x << 32;
+                return x;
+            }
+
+            // Bytes preceded by an odd-length run of backslashes. Runs that start on an odd bit are found
+            // by adding their start to the run, so the carry ripples through each run in one add.
+            uint64_t escaped(uint64_t backslash) {
+                if (!backslash && !prev_escaped) return 0;
+
+                const uint64_t even = 0x5555555555555555ULL;
+                backslash &= ~prev_escaped;
+                uint64_t follows_escape = backslash << 1 | prev_escaped;
+                uint64_t odd_starts = backslash & ~even & ~follows_escape;
+                uint64_t sum = odd_starts + backslash;
+                prev_escaped = sum < odd_starts;
+                return (even ^ (sum << 1)) & follows_escape;
+            }
+
+        public:
+            StructuralScanner() : prev_escaped(0), prev_in_string(0), prev_scalar(0) {}
+
+            // Returns the operators, opening quotes and first bytes of scalars outside strings.
+            uint64_t next(const BlockMasks& m) {
+                uint64_t quote = m.quote & ~escaped(m.backslash);
+                uint64_t in_string = prefix_xor(quote) ^ prev_in_string;
+                prev_in_string = 0 - (in_string >> 63);
+
+                uint64_t scalar = ~(m.op | m.ws);
+                uint64_t nonquote_scalar = scalar & ~quote;
+                uint64_t follows_scalar = nonquote_scalar << 1 | prev_scalar;
+                prev_scalar = nonquote_scalar >> 63;
+
+                uint64_t string_tail = in_string ^ quote;
+                return (m.op | (scalar & ~follows_scalar)) & ~string_tail;
+            }
+
+            bool in_string() const { return prev_in_string != 0; }
+        };
+
+        // Appends to out the offset of every operator, opening quote and scalar start in [data, data + len),
+        // in order. Throws parse_error if the input ends inside a string.
+        inline void structural_index(const char* data, size_t len, std::vector<uint32_t>& out,
+                                     classify_fn classify = structural_kernel()) {
+            if (len > UINT32_MAX) throw std::length_error("jsonpp: input too large for a structural index");
+
+            const unsigned char* b = reinterpret_cast<const unsigned char*>(data);
+            StructuralScanner scanner;
+            BlockMasks m;
+
+            // The tape grows geometrically ahead of the write position so the inner loop can store without
+            // checking capacity; it is trimmed to size at the end.
+            size_t n = out.size();
+            for (size_t base = 0; base < len; base += 64) {
+                if (out.size() - n < 64) out.resize(std::max(out.size() * 2, n + 64 + len / 4));
+
+                if (len - base >= 64) {
+                    classify(b + base, m);
+                } else {
+                    unsigned char tail[64];
+                    std::memset(tail, ' ', sizeof(tail));
+                    std::memcpy(tail, b + base, len - base);
+                    classify(tail, m);
+                }
+
+                uint32_t* dst = &out[n];
+                for (uint64_t bits = scanner.next(m); bits; bits &= bits - 1) {
+                    *dst++ = static_cast<uint32_t>(base + ctz64(bits));
+                }
+                n = dst - out.data();
+            }
+            out.resize(n);
+
+            if (scanner.in_string()) throw parse_error("unterminated string", len);
+        }
+
+    }
+
+    namespace detail {
+
+        // ParseLimits with unset limits raised to SIZE_MAX, so that each check is one comparison.
+        struct Limits {
+            size_t depth;
+            size_t bytes;
+            size_t string;
+            size_t members;
+            size_t nodes;
+
+            static size_t or_max(size_t limit) { return limit ? limit : SIZE_MAX; }
+
+            explicit Limits(const ParseLimits& l)
+                    : depth(or_max(l.max_depth)), bytes(or_max(l.max_bytes)), string(or_max(l.max_string_length)),
+                      members(or_max(l.max_members)), nodes(or_max(l.max_nodes)) {}
+        };
+
+        // Single-pass reader over a caller-owned buffer that checks the grammar and reports each token to
+        // Handler as it is read. Calls are resolved at compile time. Nesting is tracked on an explicit
+        // stack rather than the call stack, so document depth is bounded only by memory.
+        //
+        // An Indexed reader is stage 2 of structural indexing: instead of stepping over whitespace a byte
+        // at a time, it jumps to the next token the tape from structural_index() records. Tokens are still
+        // read and checked from the input, so both kinds accept the same documents.
+        template <typename Handler, bool Indexed = false>
+        class Reader {
+            const char* begin;
+            const char* p;
+            const char* end;
+            Handler& handler;
+
+            // With Indexed, the tape of token offsets from base, from the next one not yet passed.
+            const char* base;
+            const uint32_t* next_token;
+            const uint32_t* tape_end;
+
+            std::vector<unsigned char> stack;
+            std::string scratch;
+
+            Limits limits;
+            size_t nodes;
+            // Values so far in each open container; kept only when max_members is set.
+            std::vector<size_t> members;
+            bool validate;
+#if defined(JSONPP_INSTRUMENTATION)
+            const char* start;
+            size_t peak;
+#endif
+
+            Reader(const Reader&);
+            Reader& operator=(const Reader&);
+
+            parse_error error(const char* what) const { return parse_error(what, p - begin); }
+
+            static bool is_ws(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+            void skip_ws() {
+                if (!Indexed) {
+                    while (p != end && is_ws(*p)) ++p;
+                    return;
+                }
+
+                // Every byte from whitespace up to the next entry on the tape is whitespace. Entries behind
+                // p are inside tokens already read; ones at or past end belong to later input.
+                if (p == end || !is_ws(*p)) return;
+                while (next_token != tape_end && base + *next_token < p) ++next_token;
+                p = next_token != tape_end && base + *next_token < end ? base + *next_token : end;
+            }
+
+            // Consumes a string token. Strings without escapes are reported straight from the input;
+            // others are unescaped into scratch first.
+            StringRef string_token() {
+                const char* start = ++p;
+                const char* q = find_string_special(p, end);
+
+                if (q != end && *q == '"') {
+                    if (static_cast<size_t>(q - start) > limits.string) throw parse_error("string too long", start - 1 - begin);
+                    if (validate) check_utf8(start, q, begin);
+                    p = q + 1;
+                    return StringRef(start, q - start);
+                }
+
+                // The run before the first escape is kept as is; if it is already too long, stop here.
+                if (static_cast<size_t>(q - start) > limits.string) throw parse_error("string too long", start - 1 - begin);
+                scratch.assign(start, q);
+                p = unescape(q, end, scratch, begin, validate, limits.string);
+                if (scratch.size() > limits.string) throw parse_error("string too long", start - 1 - begin);
+                if (p == end) throw error("unterminated string");
+                // Escapes are plain ASCII, so checking the raw span checks everything between them.
+                if (validate) check_utf8(start, p, begin);
+                ++p;
+                return StringRef(scratch);
+            }
+
+            void key() {
+                skip_ws();
+                if (p == end || *p != '"') throw error("expected object key");
+                handler.on_key(string_token());
+
+                skip_ws();
+                if (p == end || *p != ':') throw error("expected ':'");
+                ++p;
+            }
+
+            void literal(const char* word, size_t len) {
+                if (static_cast<size_t>(end - p) < len || std::memcmp(p, word, len) != 0) throw error("invalid literal");
+                p += len;
+            }
+
+            void scalar() {
+                switch (*p) {
+                    case '"': handler.on_string(string_token()); return;
+                    case 't': literal("true", 4); handler.on_bool(true); return;
+                    case 'f': literal("false", 5); handler.on_bool(false); return;
+                    case 'n': literal("null", 4); handler.on_null(); return;
+                    default: {
+                        NumberResult result;
+                        if (!parse_number(p, end, result)) throw error("invalid number");
+                        if (result.integral) handler.on_number(result.integer);
+                        else handler.on_number(result.dbl);
+                    }
+                }
+            }
+
+        public:
+            // Error offsets are reported relative to origin, which defaults to data. With validate off,
+            // strings are not checked for well-formed UTF-8.
+            Reader(const char* data, size_t len, Handler& handler, const char* origin = nullptr,
+                   const ParseLimits& limits = ParseLimits(), bool validate = true)
+                    : begin(origin ? origin : data), p(data), end(data + len), handler(handler), base(nullptr),
+                      next_token(nullptr), tape_end(nullptr), limits(limits), nodes(0), validate(validate) {
+#if defined(JSONPP_INSTRUMENTATION)
+                start = data;
+                peak = 0;
+#endif
+            }
+
+            // Gives an Indexed reader the tape [first, last) of structural_index() over input starting at
+            // tape_base. It may cover more than this reader's input, as long as it includes all of it.
+            void use_tape(const char* tape_base, const uint32_t* first, const uint32_t* last) {
+                base = tape_base;
+                next_token = first;
+                tape_end = last;
+            }
+
+            void run() {
+                JSONPP_INSTRUMENT_START(started);
+                if (static_cast<size_t>(end - p) > limits.bytes) throw parse_error("input too large", p + limits.bytes - begin);
+                bool counting = limits.members != SIZE_MAX;
+
+                for (;;) {
+                    skip_ws();
+                    if (p == end) throw error("unexpected end of input");
+
+                    if (++nodes > limits.nodes) throw error("too many values");
+                    if (counting && !members.empty() && ++members.back() > limits.members) throw error("too many members");
+
+                    char c = *p;
+                    if (c == '{' || c == '[') {
+                        if (stack.size() >= limits.depth) throw error("nesting too deep");
+                        ++p;
+                        bool object = c == '{';
+                        if (object) handler.start_object();
+                        else handler.start_array();
+                        stack.push_back(object);
+                        if (counting) members.push_back(0);
+#if defined(JSONPP_INSTRUMENTATION)
+                        peak = std::max(peak, stack.size());
+#endif
+
+                        skip_ws();
+                        if (p != end && *p == (object ? '}' : ']')) {
+                            ++p;
+                            stack.pop_back();
+                            if (counting) members.pop_back();
+                            if (object) handler.end_object();
+                            else handler.end_array();
+                        } else {
+                            if (object) key();
+                            continue;
+                        }
+                    } else {
+                        scalar();
+                    }
+
+                    // A value just completed: close any finished containers, then expect the next value.
+                    for (;;) {
+                        skip_ws();
+                        if (stack.empty()) {
+                            if (p != end) throw error("unexpected trailing characters");
+                            JSONPP_INSTRUMENT(on_parse(end - start, peak, JSONPP_INSTRUMENT_ELAPSED(started)));
+                            return;
+                        }
+
+                        if (p == end) throw error("unexpected end of input");
+
+                        bool object = stack.back() != 0;
+                        if (*p == ',') {
+                            ++p;
+                            if (object) key();
+                            break;
+                        }
+
+                        if (*p != (object ? '}' : ']')) throw error("expected ',' or closing bracket");
+                        ++p;
+                        stack.pop_back();
+                        if (counting) members.pop_back();
+                        if (object) handler.end_object();
+                        else handler.end_array();
+                    }
+                }
+            }
+        };
+
+        // The Reader handler that builds a JSONValue tree. With an arena, every node, string and
+        // container is allocated from it.
+        class DomBuilder {
+            struct Frame {
+                JSONValue* node;
+                bool object;
+                bool compact;
+                JSONString key;
+
+                Frame(JSONValue* n, bool o, bool c) : node(n), object(o), compact(c) {}
+            };
+
+            Arena* arena;
+            ParseOptions options;
+            const char* input;
+            const char* input_end;
+
+            JSONValue* root;
+            std::vector<Frame> stack;
+
+            DomBuilder(const DomBuilder&);
+            DomBuilder& operator=(const DomBuilder&);
+
+            // Strings reported from the input itself had no escapes, and may be borrowed.
+            bool in_input(StringRef str) const {
+                return !std::less<const char*>()(str.data(), input) && std::less<const char*>()(str.data(), input_end);
+            }
+
+            JSONString make_string(StringRef str) const {
+                if (options.borrow_strings && in_input(str)) return JSONString::view(str.data(), str.size());
+                return JSONString(str.data(), str.size(), arena);
+            }
+
+            void attach(JSONValue* value) {
+                if (stack.empty()) {
+                    root = value;
+                    return;
+                }
+
+                Frame& top = stack.back();
+                if (top.object) {
+                    static_cast<JSONObject*>(top.node)->insert(std::move(top.key), value);
+                } else if (top.compact) {
+                    static_cast<JSONCompactArray*>(top.node)->push_back(Value(value, arena == nullptr));
+                } else {
+                    static_cast<JSONArray*>(top.node)->push_back(value);
+                }
+            }
+
+            // Scalars inside a compact array are stored inline, without allocating a node.
+            bool compact() const { return !stack.empty() && stack.back().compact; }
+            void push_value(Value value) { static_cast<JSONCompactArray*>(stack.back().node)->push_back(std::move(value)); }
+
+        public:
+            DomBuilder(const char* data, size_t len, Arena* arena, const ParseOptions& options)
+                    : arena(arena), options(options), input(data), input_end(data + len), root(nullptr) {}
+
+            // On failure the partial tree is freed; arena-backed nodes are left to the arena.
+            ~DomBuilder() {
+                if (!arena) delete root;
+            }
+
+            JSONValue* release() {
+                JSONValue* done = root;
+                root = nullptr;
+                return done;
+            }
+
+            void on_null() {
+                if (compact()) push_value(Value());
+                else attach(make<JSONNullType>(arena));
+            }
+
+            void on_bool(bool b) {
+                if (compact()) push_value(Value(b));
+                else attach(make<JSONBooleanType>(arena, b));
+            }
+
+            void on_number(int64_t i) {
+                if (compact()) push_value(Value(i));
+                else attach(make<JSONNumber>(arena, i));
+            }
+
+            void on_number(double d) {
+                if (compact()) push_value(Value(d));
+                else attach(make<JSONNumber>(arena, d));
+            }
+
+            void on_string(StringRef str) {
+                if (!compact()) {
+                    attach(make<JSONString>(arena, make_string(str)));
+                } else if (options.borrow_strings && in_input(str)) {
+                    push_value(Value::view(str.data(), str.size()));
+                } else {
+                    push_value(Value(str.data(), str.size(), arena));
+                }
+            }
+
+            void on_key(StringRef str) {
+                if (options.key_pool) {
+                    StringRef pooled = options.key_pool->intern(str);
+                    stack.back().key = JSONString::view(pooled.data(), pooled.size());
+                } else {
+                    stack.back().key = make_string(str);
+                }
+            }
+
+            void start_object() {
+                JSONValue* node = make<JSONObject>(arena, arena);
+                if (!arena && (options.borrow_strings || options.key_pool)) mark_borrowing(node);
+                attach(node);
+                stack.push_back(Frame(node, true, false));
+            }
+
+            void start_array() {
+                bool compact = options.compact_arrays;
+                JSONValue* node;
+                if (compact) node = make<JSONCompactArray>(arena, arena);
+                else node = make<JSONArray>(arena, arena);
+                if (!arena && (options.borrow_strings || options.key_pool)) mark_borrowing(node);
+                attach(node);
+                stack.push_back(Frame(node, false, compact));
+            }
+
+            void end_object() { stack.pop_back(); }
+            void end_array() { stack.pop_back(); }
+        };
+
+        // Builds the tape an Indexed reader follows. Returns false, leaving the input to the byte reader, if
+        // it is too large to index or ends inside a string; the byte reader then reports where it fails.
+        inline bool index_input(const char* data, size_t len, std::vector<uint32_t>& tape) {
+            if (len > UINT32_MAX) return false;
+            tape.clear();
+            try {
+                structural_index(data, len, tape);
+            } catch (const parse_error&) {
+                return false;
+            }
+            return true;
+        }
+
+        // Parses [data, data + len) into a tree using DomBuilder, through an Indexed reader when
+        // options.indexed is set.
+        class Parser {
+            DomBuilder builder;
+            const char* data;
+            size_t len;
+            const char* origin;
+            ParseLimits limits;
+            bool validate;
+            bool indexed;
+
+        public:
+            Parser(const char* data, size_t len, Arena* arena = nullptr, const ParseOptions& options = ParseOptions(),
+                   const char* origin = nullptr)
+                    : builder(data, len, arena, options), data(data), len(len), origin(origin), limits(options.limits),
+                      validate(options.validate_utf8), indexed(options.indexed) {}
+
+            JSONValue* run() {
+                // Input over max_bytes is refused by the reader before it is indexed. The tape is kept per
+                // thread, so repeated parses do not fault in fresh pages for it each time.
+                static thread_local std::vector<uint32_t> tape;
+                if (indexed && !(limits.max_bytes && len > limits.max_bytes) && index_input(data, len, tape)) {
+                    return run(data, tape.data(), tape.data() + tape.size());
+                }
+                Reader<DomBuilder>(data, len, builder, origin, limits, validate).run();
+                return builder.release();
+            }
+
+            // Parses through an Indexed reader following [first, last), a tape from index_input() over
+            // input starting at tape_base that covers all of [data, data + len).
+            JSONValue* run(const char* tape_base, const uint32_t* first, const uint32_t* last) {
+                Reader<DomBuilder, true> reader(data, len, builder, origin, limits, validate);
+                reader.use_tape(tape_base, first, last);
+                reader.run();
+                return builder.release();
+            }
+        };
+
+    }
+
+    inline std::ostream& operator<<(std::ostream& os, const JSONValue& value) {
+        StreamWriter writer(os);
+        value.serialize(writer);
+        return os;
+    }
+
+    // Parses a complete JSON document from [data, data + len). The buffer is not copied and need not be
+    // NUL-terminated. The caller owns the returned tree. Throws parse_error on malformed input.
+    inline JSONValue* parse(const char* data, size_t len, const ParseOptions& options = ParseOptions()) {
+        return detail::Parser(data, len, nullptr, options).run();
+    }
+
+    inline JSONValue* parse(const std::string& str, const ParseOptions& options = ParseOptions()) {
+        return parse(str.data(), str.size(), options);
+    }
+
+    // Reads a complete JSON document from [data, data + len), reporting each token to handler as it is
+    // read instead of building a tree. Handler provides on_null(), on_bool(bool), on_number(int64_t),
+    // on_number(double), on_string(StringRef), on_key(StringRef), start_object(), end_object(),
+    // start_array() and end_array(); calls are bound at compile time. A StringRef refers to the input
+    // when the string had no escapes and to a scratch buffer otherwise, valid only during the call.
+    // Throws parse_error on malformed input, possibly after some events were delivered.
+    template <typename Handler>
+    inline void sax_parse(const char* data, size_t len, Handler& handler, const ParseLimits& limits = ParseLimits()) {
+        detail::Reader<Handler>(data, len, handler, nullptr, limits).run();
+    }
+
+    template <typename Handler>
+    inline void sax_parse(const std::string& str, Handler& handler, const ParseLimits& limits = ParseLimits()) {
+        sax_parse(str.data(), str.size(), handler, limits);
+    }
+
+    namespace detail {
+
+        inline void store_be(unsigned char* p, uint64_t v, size_t n) {
+            for (size_t i = n; i-- > 0; v >>= 8) p[i] = static_cast<unsigned char>(v);
+        }
+
+        inline uint64_t load_be(const unsigned char* p, size_t n) {
+            uint64_t v = 0;
+            for (size_t i = 0; i < n; i++) v = (v << 8) | p[i];
+            return v;
+        }
+
+        // Writes trees as CBOR (RFC 8949): integers in the shortest head that holds them, every float as
+        // a 64-bit double, and strings, arrays and maps with definite lengths.
+        class BinaryEncoder {
+            Writer& out;
+
+            void head(unsigned major, uint64_t n) {
+                unsigned char buf[9];
+                size_t len = 1;
+                if (n < 24) {
+                    buf[0] = static_cast<unsigned char>(major << 5 | n);
+                } else {
+                    unsigned info = n <= 0xFF ? 24 : n <= 0xFFFF ? 25 : n <= 0xFFFFFFFFULL ? 26 : 27;
+                    len = static_cast<size_t>(1) << (info - 24);
+                    buf[0] = static_cast<unsigned char>(major << 5 | info);
+                    store_be(buf + 1, n, len);
+                    ++len;
+                }
+                out.write(reinterpret_cast<const char*>(buf), len);
+            }
+
+            void integer(int64_t i) {
+                if (i >= 0) head(0, static_cast<uint64_t>(i));
+                else head(1, static_cast<uint64_t>(-(i + 1)));
+            }
+
+            void number(double d) {
+                unsigned char buf[9] = {0xFB};
+                store_be(buf + 1, double_to_bits(d), 8);
+                out.write(reinterpret_cast<const char*>(buf), 9);
+            }
+
+            void string(const char* data, size_t len) {
+                head(3, len);
+                out.write(data, len);
+            }
+
+            void value(const Value& v) {
+                switch (v.type()) {
+                    case ValueType::NULL_TYPE: out.put(static_cast<char>(0xF6)); break;
+                    case ValueType::BOOLEAN: out.put(static_cast<char>(v.boolean() ? 0xF5 : 0xF4)); break;
+                    case ValueType::NUMBER:
+                        if (v.number_type() == NumberType::INTEGER) integer(v.number<int64_t>());
+                        else number(v.number<double>());
+                        break;
+                    case ValueType::STRING: string(v.data(), v.size()); break;
+                    default: node(*v.node()); break;
+                }
+            }
+
+        public:
+            explicit BinaryEncoder(Writer& writer) : out(writer) {}
+
+            void node(const JSONValue& node) {
+                switch (node.type()) {
+                    case ValueType::NULL_TYPE: out.put(static_cast<char>(0xF6)); break;
+                    case ValueType::BOOLEAN:
+                        out.put(static_cast<char>(static_cast<const JSONBooleanType&>(node).get() ? 0xF5 : 0xF4));
+                        break;
+                    case ValueType::NUMBER: {
+                        const JSONNumber& num = static_cast<const JSONNumber&>(node);
+                        if (num.number_type() == NumberType::INTEGER) integer(num.get<int64_t>());
+                        else number(num.get<double>());
+                        break;
+                    }
+                    case ValueType::STRING: {
+                        const JSONString& str = static_cast<const JSONString&>(node);
+                        string(str.data(), str.size());
+                        break;
+                    }
+                    case ValueType::ARRAY:
+                        if (const JSONCompactArray* compact = dynamic_cast<const JSONCompactArray*>(&node)) {
+                            head(4, compact->size());
+                            for (const Value& v : *compact) value(v);
+                        } else {
+                            const JSONArray& arr = static_cast<const JSONArray&>(node);
+                            head(4, arr.size());
+                            for (const JSONValue* element : arr) this->node(*element);
+                        }
+                        break;
+                    case ValueType::OBJECT: {
+                        const JSONObject& obj = static_cast<const JSONObject&>(node);
+                        head(5, obj.size());
+                        for (JSONObject::iterator it = obj.begin(); it != obj.end(); ++it) {
+                            string(it->first.data(), it->first.size());
+                            this->node(*it->second);
+                        }
+                        break;
+                    }
+                }
+            }
+        };
+
+        // Reads CBOR produced by BinaryEncoder, or any other encoder restricted to the JSON data model, and
+        // reports it to Handler with the same events as Reader. Strings are reported straight from the
+        // input. Integers beyond int64_t and half or single floats are widened to double. Byte strings,
+        // tags, indefinite lengths, non-string map keys and other simple values are rejected.
+        template <typename Handler>
+        class BinaryReader {
+            struct Frame {
+                uint64_t remaining;
+                bool object;
+            };
+
+            const unsigned char* begin;
+            const unsigned char* p;
+            const unsigned char* end;
+            Handler& handler;
+            std::vector<Frame> stack;
+            Limits limits;
+            size_t nodes;
+            bool validate;
+
+            BinaryReader(const BinaryReader&);
+            BinaryReader& operator=(const BinaryReader&);
+
+            parse_error error(const char* what, const unsigned char* at) const { return parse_error(what, at - begin); }
+
+            size_t left() const { return static_cast<size_t>(end - p); }
+
+            uint64_t argument(unsigned info, const unsigned char* at) {
+                if (info < 24) return info;
+                if (info > 27) throw error(info == 31 ? "indefinite length not supported" : "invalid item header", at);
+
+                size_t n = static_cast<size_t>(1) << (info - 24);
+                if (left() < n) throw error("unexpected end of input", at);
+                uint64_t v = load_be(p, n);
+                p += n;
+                return v;
+            }
+
+            StringRef text(const unsigned char* at) {
+                unsigned char initial = *p++;
+                if (initial >> 5 != 3) throw error("expected string", at);
+                uint64_t n = argument(initial & 31, at);
+                if (left() < n) throw error("unexpected end of input", at);
+                if (n > limits.string) throw error("string too long", at);
+                StringRef str(reinterpret_cast<const char*>(p), static_cast<size_t>(n));
+                if (validate) check_utf8(str.data(), str.data() + str.size(), reinterpret_cast<const char*>(begin));
+                p += n;
+                return str;
+            }
+
+            static double half_to_double(uint16_t h) {
+                int exp = (h >> 10) & 0x1F;
+                double mant = h & 0x3FF;
+                double v = exp == 0 ? std::ldexp(mant, -24)
+                                    : exp != 31 ? std::ldexp(mant + 1024, exp - 25)
+                                                : mant == 0 ? HUGE_VAL : NAN;
+                return h & 0x8000 ? -v : v;
+            }
+
+            void value() {
+                if (p == end) throw error("unexpected end of input", p);
+                if (++nodes > limits.nodes) throw error("too many values", p);
+
+                const unsigned char* at = p;
+                unsigned char initial = *p++;
+                unsigned info = initial & 31;
+                switch (initial >> 5) {
+                    case 0: {
+                        uint64_t n = argument(info, at);
+                        if (n <= static_cast<uint64_t>(INT64_MAX)) handler.on_number(static_cast<int64_t>(n));
+                        else handler.on_number(static_cast<double>(n));
+                        return;
+                    }
+                    case 1: {
+                        uint64_t n = argument(info, at);
+                        if (n <= static_cast<uint64_t>(INT64_MAX)) handler.on_number(-1 - static_cast<int64_t>(n));
+                        else handler.on_number(-1.0 - static_cast<double>(n));
+                        return;
+                    }
+                    case 3:
+                        --p;
+                        handler.on_string(text(at));
+                        return;
+                    case 4:
+                    case 5: {
+                        bool object = initial >> 5 == 5;
+                        uint64_t n = argument(info, at);
+                        // Every member takes at least one byte per item, which bounds a hostile count.
+                        if (n > left() / (object ? 2 : 1)) throw error("container length exceeds input", at);
+                        if (n > limits.members) throw error("too many members", at);
+                        if (stack.size() >= limits.depth) throw error("nesting too deep", at);
+                        if (object) handler.start_object();
+                        else handler.start_array();
+                        Frame frame = {n, object};
+                        stack.push_back(frame);
+                        return;
+                    }
+                    case 7:
+                        switch (info) {
+                            case 20: handler.on_bool(false); return;
+                            case 21: handler.on_bool(true); return;
+                            case 22: handler.on_null(); return;
+                            case 25: handler.on_number(half_to_double(static_cast<uint16_t>(argument(info, at)))); return;
+                            case 26: {
+                                uint32_t bits = static_cast<uint32_t>(argument(info, at));
+                                float f;
+                                std::memcpy(&f, &bits, sizeof(f));
+                                handler.on_number(static_cast<double>(f));
+                                return;
+                            }
+                            case 27: handler.on_number(bits_to_double(argument(info, at))); return;
+                            default: throw error("unsupported simple value", at);
+                        }
+                    default:
+                        throw error("unsupported item type", at);
+                }
+            }
+
+        public:
+            BinaryReader(const char* data, size_t len, Handler& handler, const ParseLimits& limits = ParseLimits(),
+                         bool validate = true)
+                    : begin(reinterpret_cast<const unsigned char*>(data)), p(begin), end(begin + len), handler(handler),
+                      limits(limits), nodes(0), validate(validate) {}
+
+            void run() {
+                if (left() > limits.bytes) throw error("input too large", p + limits.bytes);
+                value();
+                while (!stack.empty()) {
+                    Frame& top = stack.back();
+                    if (!top.remaining) {
+                        bool object = top.object;
+                        stack.pop_back();
+                        if (object) handler.end_object();
+                        else handler.end_array();
+                        continue;
+                    }
+
+                    --top.remaining;
+                    if (top.object) {
+                        if (p == end) throw error("unexpected end of input", p);
+                        handler.on_key(text(p));
+                    }
+                    value();
+                }
+                if (p != end) throw error("unexpected trailing bytes", p);
+            }
+        };
+
+    }
+
+    // Encodes value as CBOR into out. Unlike text output, non-finite doubles survive the round trip.
+    inline void to_binary(const JSONValue& value, Writer& out) {
+        detail::BinaryEncoder(out).node(value);
+    }
+
+    inline std::string to_binary(const JSONValue& value) {
+        std::string out;
+        StringWriter writer(out);
+        to_binary(value, writer);
+        return out;
+    }
+
+    // Decodes one CBOR item spanning all of [data, data + len) into a tree the caller owns. Strings are
+    // length-prefixed, so they are scanned only to validate UTF-8; with borrow_strings set, string values
+    // point into data.
+    // Throws parse_error with the offset of the offending item on malformed or unsupported input.
+    inline JSONValue* from_binary(const char* data, size_t len, const ParseOptions& options = ParseOptions()) {
+        detail::DomBuilder builder(data, len, nullptr, options);
+        detail::BinaryReader<detail::DomBuilder>(data, len, builder, options.limits, options.validate_utf8).run();
+        return builder.release();
+    }
+
+    inline JSONValue* from_binary(const std::string& str, const ParseOptions& options = ParseOptions()) {
+        return from_binary(str.data(), str.size(), options);
+    }
+
+    struct LineOptions {
+        // Worker threads; 0 uses one per hardware thread.
+        unsigned threads;
+
+        // Deliver records in input order. Otherwise each chunk's records are delivered as soon as it is parsed.
+        bool ordered;
+
+        // Approximate bytes of input per unit of work.
+        size_t chunk_size;
+
+        // Applied to every record. A key_pool shared by the workers must be thread-safe.
+        ParseOptions parse;
+
+        LineOptions() : threads(0), ordered(true), chunk_size(1 << 20) {}
+    };
+
+    namespace detail {
+
+        // Splits newline-delimited input into chunks of whole lines and parses them on a set of threads.
+        // Workers claim chunks from a shared cursor, so a slow chunk does not hold up the others.
+        template <typename Callback>
+        class LineReader {
+            struct Chunk {
+                const char* begin;
+                const char* end;
+                std::vector<JSONValue*> values;
+                bool done;
+
+                Chunk(const char* b, const char* e) : begin(b), end(e), done(false) {}
+            };
+
+            const char* origin;
+            Callback& callback;
+            const LineOptions& options;
+            std::vector<Chunk> chunks;
+            size_t window;
+
+            std::mutex lock;
+            std::condition_variable ready;
+            size_t next;
+            size_t delivered;
+            bool delivering;
+            std::exception_ptr failure;
+
+            std::mutex deliver_lock;
+
+            LineReader(const LineReader&);
+            LineReader& operator=(const LineReader&);
+
+            // With options.parse.indexed, the whole chunk is indexed at once and each record follows its
+            // part of the tape. tape is the worker's, reused from chunk to chunk.
+            void parse_chunk(Chunk& chunk, std::vector<uint32_t>& tape) {
+                bool indexed = options.parse.indexed && index_input(chunk.begin, chunk.end - chunk.begin, tape);
+                const uint32_t* token = tape.data();
+                const uint32_t* last = token + tape.size();
+
+                for (const char* p = chunk.begin; p != chunk.end;) {
+                    const char* nl = static_cast<const char*>(std::memchr(p, '\n', chunk.end - p));
+                    const char* stop = nl ? nl : chunk.end;
+
+                    const char* q = p;
+                    while (q != stop && (*q == ' ' || *q == '\t' || *q == '\r')) ++q;
+                    if (q != stop) {
+                        chunk.values.push_back(nullptr);
+                        Parser parser(q, stop - q, nullptr, options.parse, origin);
+                        if (indexed) {
+                            while (token != last && chunk.begin + *token < q) ++token;
+                            chunk.values.back() = parser.run(chunk.begin, token, last);
+                        } else {
+                            chunk.values.back() = parser.run();
+                        }
+                    }
+                    p = nl ? nl + 1 : chunk.end;
+                }
+            }
+
+            // Hands the chunk's records over one at a time, so a throwing callback leaves the rest to be freed.
+            void deliver(Chunk& chunk) {
+                for (JSONValue*& value : chunk.values) {
+                    JSONValue* v = value;
+                    value = nullptr;
+                    callback(v);
+                }
+            }
+
+            void fail() {
+                std::lock_guard<std::mutex> guard(lock);
+                if (!failure) failure = std::current_exception();
+                ready.notify_all();
+            }
+
+            // In order mode one thread at a time drains the finished prefix, outside the lock.
+            void deliver_ordered(std::unique_lock<std::mutex>& held) {
+                if (delivering) return;
+                delivering = true;
+                while (!failure && delivered < chunks.size() && chunks[delivered].done) {
+                    Chunk& chunk = chunks[delivered];
+                    held.unlock();
+                    try {
+                        deliver(chunk);
+                    } catch (...) {
+                        held.lock();
+                        delivering = false;
+                        if (!failure) failure = std::current_exception();
+                        ready.notify_all();
+                        return;
+                    }
+                    held.lock();
+                    delivered++;
+                    ready.notify_all();
+                }
+                delivering = false;
+            }
+
+            void work() {
+                std::vector<uint32_t> tape;
+                for (;;) {
+                    size_t i;
+                    {
+                        std::unique_lock<std::mutex> held(lock);
+                        // Bound how far parsing may run ahead of delivery, and with it memory.
+                        if (options.ordered) {
+                            ready.wait(held, [this] { return failure || next >= chunks.size() || next < delivered + window; });
+                        }
+                        if (failure || next >= chunks.size()) return;
+                        i = next++;
+                    }
+
+                    try {
+                        parse_chunk(chunks[i], tape);
+                    } catch (...) {
+                        fail();
+                        return;
+                    }
+
+                    if (options.ordered) {
+                        std::unique_lock<std::mutex> held(lock);
+                        chunks[i].done = true;
+                        deliver_ordered(held);
+                    } else {
+                        try {
+                            std::lock_guard<std::mutex> guard(deliver_lock);
+                            deliver(chunks[i]);
+                        } catch (...) {
+                            fail();
+                            return;
+                        }
+                    }
+                }
+            }
+
+        public:
+            LineReader(const char* data, size_t len, Callback& callback, const LineOptions& options)
+                    : origin(data), callback(callback), options(options), window(0), next(0), delivered(0), delivering(false) {
+                size_t step = std::max<size_t>(options.chunk_size, 1);
+                const char* end = data + len;
+                for (const char* p = data; p != end;) {
+                    const char* stop = p + std::min<size_t>(step, end - p);
+                    if (stop != end) {
+                        const char* nl = static_cast<const char*>(std::memchr(stop - 1, '\n', end - stop + 1));
+                        stop = nl ? nl + 1 : end;
+                    }
+                    chunks.push_back(Chunk(p, stop));
+                    p = stop;
+                }
+            }
+
+            ~LineReader() {
+                for (Chunk& chunk : chunks) {
+                    for (JSONValue* value : chunk.values) delete value;
+                }
+            }
+
+            void run() {
+                unsigned n = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+                n = static_cast<unsigned>(std::min<size_t>(n, chunks.size()));
+                window = 4 * static_cast<size_t>(n);
+
+                if (n <= 1) {
+                    work();
+                } else {
+                    std::vector<std::thread> workers;
+                    for (unsigned i = 0; i < n; i++) workers.push_back(std::thread(&LineReader::work, this));
+                    for (std::thread& worker : workers) worker.join();
+                }
+
+                if (failure) std::rethrow_exception(failure);
+            }
+        };
+
+    }
+
+    // Parses newline-delimited JSON (one value per line; blank lines are skipped) on several threads and
+    // passes each record to callback, which takes ownership. Calls to callback never overlap. A raw
+    // newline cannot occur inside a JSON string, so the input is split with a plain newline search.
+    // The first error from a record or from callback stops the workers and is rethrown here; parse
+    // errors carry offsets into the whole input.
+    template <typename Callback>
+    inline void parse_lines(const char* data, size_t len, Callback callback, const LineOptions& options = LineOptions()) {
+        detail::LineReader<Callback>(data, len, callback, options).run();
+    }
+
+    template <typename Callback>
+    inline void parse_lines(const std::string& str, Callback callback, const LineOptions& options = LineOptions()) {
+        parse_lines(str.data(), str.size(), callback, options);
+    }
+
+    // A read-only mapping of a whole file. The contents stay valid, and in place, for the object's lifetime.
+    // Throws std::system_error if the file cannot be opened or mapped.
+    class MappedFile {
+        const char* ptr;
+        size_t len;
+#if defined(_WIN32)
+        HANDLE mapping;
+#endif
+
+        MappedFile(const MappedFile&);
+        MappedFile& operator=(const MappedFile&);
+
+        void unmap() {
+            if (!len) return;
+#if defined(_WIN32)
+            UnmapViewOfFile(ptr);
+            CloseHandle(mapping);
+#else
+            munmap(const_cast<char*>(ptr), len);
+#endif
+        }
+
+    public:
+        explicit MappedFile(const std::string& path) : ptr(""), len(0) {
+#if defined(_WIN32)
+            mapping = nullptr;
+            HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                      FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file == INVALID_HANDLE_VALUE) {
+                throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "jsonpp: cannot open " + path);
+            }
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(file, &size)) {
+                DWORD code = GetLastError();
+                CloseHandle(file);
+                throw std::system_error(static_cast<int>(code), std::system_category(), "jsonpp: cannot stat " + path);
+            }
+            if (size.QuadPart == 0) {
+                CloseHandle(file);
+                return;
+            }
+
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+            DWORD code = GetLastError();
+            CloseHandle(file);
+            if (!view) {
+                if (mapping) CloseHandle(mapping);
+                throw std::system_error(static_cast<int>(code), std::system_category(), "jsonpp: cannot map " + path);
+            }
+            ptr = static_cast<const char*>(view);
+            len = static_cast<size_t>(size.QuadPart);
+#else
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) throw std::system_error(errno, std::generic_category(), "jsonpp: cannot open " + path);
+
+            struct stat st;
+            if (fstat(fd, &st) != 0) {
+                int code = errno;
+                ::close(fd);
+                throw std::system_error(code, std::generic_category(), "jsonpp: cannot stat " + path);
+            }
+            if (st.st_size == 0) {
+                ::close(fd);
+                return;
+            }
+
+            void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            int code = errno;
+            ::close(fd);
+            if (view == MAP_FAILED) throw std::system_error(code, std::generic_category(), "jsonpp: cannot map " + path);
+
+            // Parsing reads front to back: ask for aggressive read-ahead and early reclaim behind it.
+            madvise(view, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+            ptr = static_cast<const char*>(view);
+            len = static_cast<size_t>(st.st_size);
+#endif
+        }
+
+        MappedFile(MappedFile&& that) : ptr(that.ptr), len(that.len) {
+#if defined(_WIN32)
+            mapping = that.mapping;
+#endif
+            that.ptr = "";
+            that.len = 0;
+        }
+
+        ~MappedFile() { unmap(); }
+
+        const char* data() const { return ptr; }
+        size_t size() const { return len; }
+    };
+
+    // Parses a whole file through a memory mapping instead of reading it into a buffer. The mapping is
+    // released before returning, so strings are always copied; use Document::parse_file to borrow them.
+    inline JSONValue* parse_file(const std::string& path, ParseOptions options = ParseOptions()) {
+        MappedFile file(path);
+        options.borrow_strings = false;
+        return parse(file.data(), file.size(), options);
+    }
+
+    // Owns a tree whose nodes, strings and container storage all live in one arena, so the whole
+    // document is released at once instead of node by node. Nodes added to the tree should be
+    // created through the document; to keep a subtree past the document's lifetime, clone() it.
+    class Document {
+        std::unique_ptr<Arena> pool;
+        std::unique_ptr<MappedFile> source;
+        JSONValue* top;
+        size_t block_size;
+
+        Document(const Document&);
+        Document& operator=(const Document&);
+
+        // A moved-from document gets a new arena when it is next used, so that its nodes never fall
+        // back to the heap, where nothing would free them.
+        Arena* storage() {
+            if (!pool) pool.reset(new Arena(block_size));
+            return pool.get();
+        }
+
+    public:
+        explicit Document(size_t initial_block_size = 4096)
+                : pool(new Arena(initial_block_size)), top(nullptr), block_size(initial_block_size) {}
+
+        Document(Document&& that) noexcept
+                : pool(std::move(that.pool)), source(std::move(that.source)), top(that.top), block_size(that.block_size) {
+            that.top = nullptr;
+        }
+
+        Document& operator=(Document&& that) noexcept {
+            if (this != &that) {
+                pool = std::move(that.pool);
+                source = std::move(that.source);
+                top = that.top;
+                block_size = that.block_size;
+                that.top = nullptr;
+            }
+            return *this;
+        }
+
+        // Replaces the current tree. Arena memory from the previous parse is recycled.
+        JSONValue* parse(const char* data, size_t len, const ParseOptions& options = ParseOptions()) {
+            clear();
+            top = detail::Parser(data, len, storage(), options).run();
+            return top;
+        }
+
+        JSONValue* parse(const std::string& str, const ParseOptions& options = ParseOptions()) {
+            return parse(str.data(), str.size(), options);
+        }
+
+        // Replaces the current tree with one decoded from CBOR; see from_binary().
+        JSONValue* from_binary(const char* data, size_t len, const ParseOptions& options = ParseOptions()) {
+            clear();
+            detail::DomBuilder builder(data, len, storage(), options);
+            detail::BinaryReader<detail::DomBuilder>(data, len, builder, options.limits, options.validate_utf8).run();
+            top = builder.release();
+            return top;
+        }
+
+        JSONValue* from_binary(const std::string& str, const ParseOptions& options = ParseOptions()) {
+            return from_binary(str.data(), str.size(), options);
+        }
+
+        // Parses a file through a memory mapping that the document keeps until the next parse or clear(),
+        // so with borrow_strings set, string values point straight into the mapped file.
+        JSONValue* parse_file(const std::string& path, const ParseOptions& options = ParseOptions()) {
+            std::unique_ptr<MappedFile> file(new MappedFile(path));
+            parse(file->data(), file->size(), options);
+            source = std::move(file);
+            return top;
+        }
+
+        void clear() {
+            top = nullptr;
+            if (pool) pool->reset();
+            source.reset();
+        }
+
+        JSONValue* root() { return top; }
+        const JSONValue* root() const { return top; }
+        void set_root(JSONValue* value) { top = value; }
+
+        Arena& arena() { return *storage(); }
+
+        JSONArray* make_array() { return detail::make<JSONArray>(storage(), storage()); }
+        JSONObject* make_object() { return detail::make<JSONObject>(storage(), storage()); }
+        JSONString* make_string(const char* str, size_t len) { return detail::make<JSONString>(storage(), str, len, storage()); }
+        JSONString* make_string(const std::string& str) { return make_string(str.data(), str.size()); }
+
+        // For scalar node types; use the make_* helpers above for anything with storage.
+        template <typename T, typename... Args>
+        T* make(Args&&... args) { return detail::make<T>(storage(), std::forward<Args>(args)...); }
+    };
+
+    // The current version of a frozen tree, for many reader threads and occasional writers (RCU style).
+    // load() takes a snapshot that stays valid for as long as the reader holds it, however often the tree
+    // is replaced meanwhile; publish() swaps in a new version without waiting for readers, and the old one
+    // is freed by whichever thread lets go of its last snapshot.
+    class AtomicTree {
+    public:
+        typedef std::shared_ptr<const JSONValue> Snapshot;
+
+    private:
+#if defined(__cpp_lib_atomic_shared_ptr)
+        std::atomic<Snapshot> current;
+#else
+        Snapshot current;
+#endif
+
+        AtomicTree(const AtomicTree&);
+        AtomicTree& operator=(const AtomicTree&);
+
+        Snapshot exchange(Snapshot next) {
+#if defined(__cpp_lib_atomic_shared_ptr)
+            return current.exchange(std::move(next), std::memory_order_acq_rel);
+#else
+            return std::atomic_exchange_explicit(&current, std::move(next), std::memory_order_acq_rel);
+#endif
+        }
+
+    public:
+        AtomicTree() {}
+        explicit AtomicTree(NodePtr root) { publish(std::move(root)); }
+
+        // Empty until something is published.
+        Snapshot load() const {
+#if defined(__cpp_lib_atomic_shared_ptr)
+            return current.load(std::memory_order_acquire);
+#else
+            return std::atomic_load_explicit(&current, std::memory_order_acquire);
+#endif
+        }
+
+        // Freezes root and makes it the current version. Returns the version it replaces.
+        Snapshot publish(NodePtr root) {
+            if (root) freeze(root.get());
+            return exchange(Snapshot(root.release()));
+        }
+
+        // Takes over doc, whose arena then lives until the last snapshot of its tree is released.
+        Snapshot publish(Document&& doc) {
+            std::shared_ptr<Document> owner(new Document(std::move(doc)));
+            if (!owner->root()) return exchange(Snapshot());
+            freeze(owner->root());
+            return exchange(Snapshot(owner, owner->root()));
+        }
+    };
+
+    // A resumable parser for input that arrives in pieces. feed() may split the text anywhere, including
+    // inside strings, numbers and escapes; only a token that straddles two pieces is copied. Each value
+    // that completes at split_depth is handed to the callback, which takes ownership, as soon as it
+    // closes: depth 0 yields every top-level value, so a stream of them such as NDJSON works, and depth 1
+    // yields the elements or member values of the top-level container one at a time without ever holding
+    // the whole document. Values above split_depth are checked but not kept.
+    class PushParser {
+    public:
+        typedef std::function<void(JSONValue*)> Callback;
+
+    private:
+        enum Expect {
+            VALUE,
+            FIRST_VALUE,
+            KEY,
+            FIRST_KEY,
+            COLON,
+            NEXT
+        };
+
+        enum Token {
+            NO_TOKEN,
+            STRING,
+            NUMBER,
+            LITERAL
+        };
+
+        struct Frame {
+            JSONValue* node;
+            bool object;
+            size_t members;
+            JSONString key;
+
+            Frame(JSONValue* n, bool o) : node(n), object(o), members(0) {}
+        };
+
+        Callback emit;
+        size_t split;
+        std::vector<Frame> stack;
+        Expect expect;
+
+        detail::Limits limits;
+        // Values in the current top-level value, and the most raw bytes a buffered string may take: an
+        // escape is at most six bytes for one character, so this never cuts a string that fits.
+        size_t nodes;
+        size_t token_budget;
+
+        // Numbers are held to a fixed length whether they arrive whole or split, so where the pieces
+        // break never changes the result. No double or int64 needs anywhere near this many digits.
+        static const size_t max_number_length = 4096;
+
+        // The token in progress when a piece ran out, with its raw bytes so far.
+        Token token;
+        bool token_is_key;
+        bool escape;
+        size_t token_offset;
+        std::string pending;
+
+        size_t consumed;
+        const char* chunk;
+
+        PushParser(const PushParser&);
+        PushParser& operator=(const PushParser&);
+
+        parse_error error(const char* what, const char* at) const { return parse_error(what, consumed + (at - chunk)); }
+
+        static bool is_ws(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+        static bool is_number_char(char c) {
+            return detail::is_digit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+        }
+
+        void attach(JSONValue* value) {
+            Frame& top = stack.back();
+            if (top.object) static_cast<JSONObject*>(top.node)->insert(std::move(top.key), value);
+            else static_cast<JSONArray*>(top.node)->push_back(value);
+        }
+
+        void deliver(JSONValue* value) {
+            size_t depth = stack.size();
+            if (depth == split) emit(value);
+            else if (depth < split) delete value;
+            else attach(value);
+            expect = stack.empty() ? VALUE : NEXT;
+        }
+
+        // Containers above split_depth are tracked but not built; deeper ones are attached as they open.
+        void open(bool object, const char* at) {
+            size_t depth = stack.size();
+            if (depth >= limits.depth) throw error("nesting too deep", at);
+            JSONValue* node = nullptr;
+            if (depth >= split) {
+                if (object) node = new JSONObject();
+                else node = new JSONArray();
+                if (depth > split) attach(node);
+            }
+            stack.push_back(Frame(node, object));
+            expect = object ? FIRST_KEY : FIRST_VALUE;
+        }
+
+        void close() {
+            JSONValue* node = stack.back().node;
+            stack.pop_back();
+            if (stack.size() == split) emit(node);
+            expect = stack.empty() ? VALUE : NEXT;
+        }
+
+        // Returns where the current token ends in [p, end): its closing quote, or the first byte that cannot
+        // continue a number or literal. Returns end if the token may continue into the next piece.
+        const char* token_end(const char* p, const char* end) {
+            if (token == NUMBER) {
+                while (p != end && is_number_char(*p)) ++p;
+                return p;
+            }
+            if (token == LITERAL) {
+                while (p != end && *p >= 'a' && *p <= 'z') ++p;
+                return p;
+            }
+
+            if (escape) {
+                if (p == end) return end;
+                ++p;
+                escape = false;
+            }
+            for (;;) {
+                p = detail::find_string_special(p, end);
+                if (p == end || *p == '"') return p;
+                if (*p == '\\' && ++p == end) {
+                    escape = true;
+                    return end;
+                }
+                ++p;
+            }
+        }
+
+        JSONString decode(const char* start, const char* stop) const {
+            std::string out;
+            const char* q = start;
+            try {
+                detail::check_utf8(start, stop, start);
+                q = detail::find_string_special(start, stop);
+                if (q != stop && static_cast<size_t>(q - start) <= limits.string) {
+                    out.assign(start, q);
+                    detail::unescape(q, stop, out, start, true, limits.string);
+                }
+            } catch (const parse_error& e) {
+                throw parse_error(e.message(), token_offset + 1 + e.offset());
+            }
 
-        for (auto& c : str) {
-            char ca[4] = {};
+            size_t len = q == stop ? stop - start : out.size();
+            if (static_cast<size_t>(q - start) > limits.string || len > limits.string) {
+                throw parse_error("string too long", token_offset);
+            }
+            if (q == stop) return JSONString(start, stop - start);
+            return JSONString(std::move(out));
+        }
 
-            switch (c) {
-                default:
-                    ca[0] = c;
-                    break;
+        // Buffers more of a token split across pieces, within the size the limits allow.
+        void buffer(const char* p, const char* stop) {
+            size_t n = pending.size() + (stop - p);
+            if (token == STRING && n > token_budget) throw parse_error("string too long", token_offset);
+            if (token == NUMBER && n > max_number_length) throw parse_error("number too long", token_offset);
+            if (token == LITERAL && n > 5) throw parse_error("invalid literal", token_offset);
+            pending.append(p, stop);
+        }
 
-                case '"':
-                case '\\':
-                case '/':
-                    ca[0] = '\\';
-                    ca[1] = c;
-                    break;
+        // [start, stop) is the whole token; for strings, the body between the quotes.
+        void finish_token(const char* start, const char* stop) {
+            Token type = token;
+            token = NO_TOKEN;
 
-                case '\b':
-                    ca[0] = '\\';
-                    ca[1] = 'b';
-                    break;
+            if (type == STRING) {
+                JSONString str = decode(start, stop);
+                pending.clear();
+                if (token_is_key) {
+                    stack.back().key = std::move(str);
+                    expect = COLON;
+                } else {
+                    deliver(new JSONString(std::move(str)));
+                }
+                return;
+            }
 
-                case '\f':
-                    ca[0] = '\\';
-                    ca[1] = 'f';
-                    break;
+            JSONValue* value;
+            if (type == NUMBER) {
+                if (static_cast<size_t>(stop - start) > max_number_length) {
+                    throw parse_error("number too long", token_offset);
+                }
+                detail::NumberResult result;
+                const char* q = start;
+                if (!detail::parse_number(q, stop, result) || q != stop) {
+                    throw parse_error("invalid number", token_offset + (q - start));
+                }
+                if (result.integral) value = new JSONNumber(result.integer);
+                else value = new JSONNumber(result.dbl);
+            } else {
+                size_t n = stop - start;
+                if (n == 4 && std::memcmp(start, "true", 4) == 0) value = new JSONBooleanType(true);
+                else if (n == 5 && std::memcmp(start, "false", 5) == 0) value = new JSONBooleanType(false);
+                else if (n == 4 && std::memcmp(start, "null", 4) == 0) value = new JSONNullType();
+                else throw parse_error("invalid literal", token_offset);
+            }
+            pending.clear();
+            deliver(value);
+        }
 
-                case '\n':
-                    ca[0] = '\\';
-                    ca[1] = 'n';
-                    break;
+        // Starts a token whose bytes begin at start; at is the token's first byte (the quote, for strings).
+        const char* begin_token(Token type, bool key, const char* start, const char* end, const char* at) {
+            token = type;
+            token_is_key = key;
+            escape = false;
+            token_offset = consumed + (at - chunk);
 
-                case '\r':
-                    ca[0] = '\\';
-                    ca[1] = 'r';
-                    break;
+            const char* stop = token_end(start, end);
+            if (stop == end) {
+                pending.clear();
+                buffer(start, end);
+                return end;
+            }
+            finish_token(start, stop);
+            return type == STRING ? stop + 1 : stop;
+        }
 
-                case '\t':
-                    ca[0] = '\\';
-                    ca[1] = 't';
+        const char* resume(const char* p, const char* end) {
+            Token type = token;
+            const char* stop = token_end(p, end);
+            buffer(p, stop);
+            if (stop == end) return end;
+
+            finish_token(pending.data(), pending.data() + pending.size());
+            return type == STRING ? stop + 1 : stop;
+        }
+
+        const char* step(const char* p, const char* end) {
+            while (p != end && is_ws(*p)) ++p;
+            if (p == end) return end;
+
+            char c = *p;
+            switch (expect) {
+                case COLON:
+                    if (c != ':') throw error("expected ':'", p);
+                    expect = VALUE;
+                    return p + 1;
+
+                case NEXT:
+                    if (c == ',') {
+                        expect = stack.back().object ? KEY : VALUE;
+                        return p + 1;
+                    }
+                    if (c != (stack.back().object ? '}' : ']')) throw error("expected ',' or closing bracket", p);
+                    close();
+                    return p + 1;
+
+                case FIRST_KEY:
+                    if (c == '}') {
+                        close();
+                        return p + 1;
+                    }
+                    // fallthrough
+                case KEY:
+                    if (c != '"') throw error("expected object key", p);
+                    return begin_token(STRING, true, p + 1, end, p);
+
+                case FIRST_VALUE:
+                    if (c == ']') {
+                        close();
+                        return p + 1;
+                    }
+                    // fallthrough
+                case VALUE:
                     break;
             }
 
-            out.append(ca);
+            if (stack.empty()) nodes = 0;
+            if (++nodes > limits.nodes) throw error("too many values", p);
+            if (!stack.empty() && ++stack.back().members > limits.members) throw error("too many members", p);
+
+            if (c == '{' || c == '[') {
+                open(c == '{', p);
+                return p + 1;
+            }
+            if (c == '"') return begin_token(STRING, false, p + 1, end, p);
+            if (c == '-' || detail::is_digit(c)) return begin_token(NUMBER, false, p, end, p);
+            if (c >= 'a' && c <= 'z') return begin_token(LITERAL, false, p, end, p);
+            throw error("unexpected character", p);
         }
 
-        return out;
-    }
+    public:
+        explicit PushParser(Callback callback, size_t split_depth = 0)
+                : PushParser(std::move(callback), split_depth, ParseLimits()) {}
 
-    std::string parse_str(const std::string &str) {
-        return "";
-    }
+        // Applies limits to the stream as it arrives: max_bytes to everything fed since the stream began,
+        // max_nodes to each top-level value, and the rest as in parse(). A string split across pieces is
+        // buffered only while it could still fit max_string_length; numbers are capped at a fixed length.
+        PushParser(Callback callback, size_t split_depth, const ParseLimits& limits)
+                : emit(std::move(callback)), split(split_depth), expect(VALUE), limits(limits), nodes(0),
+                  token_budget(this->limits.string > SIZE_MAX / 6 ? SIZE_MAX : this->limits.string * 6),
+                  token(NO_TOKEN), token_is_key(false), escape(false), token_offset(0), consumed(0), chunk(nullptr) {}
 
-    class JSONValue {
-    public:
-        virtual std::string to_string() const = 0;
-        virtual JSONValue* create() const = 0;
-        virtual JSONValue* clone() const = 0;
-        virtual ~JSONValue() {}
-    };
+        ~PushParser() { reset(); }
 
-    JSONValue* clone(const JSONValue* that) {
-        return that->clone();
-    }
+        // Parses the next piece of input. The piece need not outlive the call.
+        void feed(const char* data, size_t len) {
+            if (len > limits.bytes - consumed) throw parse_error("input too large", limits.bytes);
+            chunk = data;
+            const char* p = data;
+            const char* end = data + len;
 
-    class JSONNullType : public JSONValue {
-    public:
-        JSONNullType() : JSONValue() {}
-        std::string to_string() const {return "null";}
+            if (token != NO_TOKEN) p = resume(p, end);
+            while (p != end) p = step(p, end);
+            consumed += len;
+        }
 
-        JSONNullType* create() const {
-            return new JSONNullType();
+        void feed(const std::string& str) { feed(str.data(), str.size()); }
+
+        // Ends the input, completing a trailing top-level number or literal. Throws parse_error if the
+        // input stopped inside a value. The parser is then ready for a new stream.
+        void finish() {
+            if (token == STRING) throw parse_error("unterminated string", consumed);
+            if (token != NO_TOKEN) finish_token(pending.data(), pending.data() + pending.size());
+            if (!stack.empty()) throw parse_error("unexpected end of input", consumed);
+            reset();
         }
 
-        JSONNullType* clone() const {
-            return new JSONNullType();
+        // Drops any partial value, e.g. after a parse_error, and starts over.
+        void reset() {
+            if (stack.size() > split) delete stack[split].node;
+            stack.clear();
+            expect = VALUE;
+            token = NO_TOKEN;
+            pending.clear();
+            nodes = 0;
+            consumed = 0;
         }
+
+        // Bytes fed since the stream began.
+        size_t offset() const { return consumed; }
     };
 
-    class JSONBooleanType : public JSONValue {
+    namespace detail {
 
-        bool value;
+        // Structural index behind LazyDocument: where the root value starts and, for every container,
+        // where its closing bracket is, so a subtree can be stepped over without reading it.
+        class LazyIndex {
+            struct Span {
+                size_t open;
+                size_t close;
+            };
 
-    public:
-        JSONBooleanType(bool type) : JSONValue(), value(type) {}
-        JSONBooleanType() : JSONValue(), value(false) {}
+            std::vector<Span> spans;
 
-        std::string to_string() const {return value ? "true" : "false";}
+            static bool is_ws(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
 
-        JSONBooleanType* create() const {
-            return new JSONBooleanType();
+        public:
+            const char* begin;
+            const char* end;
+            const char* top;
+
+            LazyIndex() : begin(nullptr), end(nullptr), top(nullptr) {}
+
+            parse_error error(const char* what, const char* at) const { return parse_error(what, at - begin); }
+
+            const char* skip_ws(const char* p) const {
+                while (p != end && is_ws(*p)) ++p;
+                return p;
+            }
+
+            // p is at an opening quote; returns the position just past the closing one.
+            const char* skip_string(const char* p) const {
+                const char* q = find_string_special(p + 1, end);
+                for (;;) {
+                    if (q == end) throw error("unterminated string", p);
+                    if (*q == '"') return q + 1;
+                    q += *q == '\\' ? 2 : 1;
+                    if (q >= end) throw error("unterminated string", p);
+                    q = find_string_special(q, end);
+                }
+            }
+
+            const char* skip_scalar(const char* p) const {
+                while (p != end && !is_ws(*p) && !std::strchr(",:[]{}\"", *p)) ++p;
+                return p;
+            }
+
+            // Returns the position just past the value starting at p.
+            const char* skip(const char* p) const {
+                if (*p == '"') return skip_string(p);
+                if (*p != '{' && *p != '[') return skip_scalar(p);
+
+                size_t open = p - begin;
+                auto it = std::lower_bound(spans.begin(), spans.end(), open,
+                                           [](const Span& s, size_t off) { return s.open < off; });
+                if (it == spans.end() || it->open != open) throw error("malformed value", p);
+                return begin + it->close + 1;
+            }
+
+            // Stage 2: walks the structural tape, checking brackets balance and recording each container's
+            // extent. Strings are known to terminate; everything else is validated when it is read.
+            void build(const char* data, size_t len) {
+                begin = data;
+                end = data + len;
+                spans.clear();
+
+                std::vector<uint32_t> tape;
+                structural_index(data, len, tape);
+                if (tape.empty()) throw error("unexpected end of input", end);
+                top = begin + tape[0];
+
+                size_t t = 1;
+                if (*top == '{' || *top == '[') {
+                    std::vector<size_t> open;
+                    for (t = 0; t < tape.size(); t++) {
+                        const char* p = begin + tape[t];
+                        char c = *p;
+                        if (c == '{' || c == '[') {
+                            open.push_back(spans.size());
+                            Span span = {tape[t], 0};
+                            spans.push_back(span);
+                        } else if (c == '}' || c == ']') {
+                            if (open.empty() || begin[spans[open.back()].open] != (c == '}' ? '{' : '[')) {
+                                throw error("mismatched closing bracket", p);
+                            }
+                            spans[open.back()].close = tape[t];
+                            open.pop_back();
+                            if (open.empty()) break;
+                        }
+                    }
+                    if (!open.empty()) throw error("unexpected end of input", end);
+                    t++;
+                } else if (*top == '}' || *top == ']') {
+                    throw error("mismatched closing bracket", top);
+                }
+
+                if (t < tape.size()) throw error("unexpected trailing characters", begin + tape[t]);
+            }
+        };
+
+    }
+
+    // A value inside a LazyDocument. It is a position in the buffer; reading it parses only that value,
+    // and walking a container steps over members that are not asked for.
+    class LazyValue {
+        const detail::LazyIndex* idx;
+        const char* p;
+
+        LazyValue(const detail::LazyIndex* index, const char* at) : idx(index), p(at) {}
+
+        friend class LazyDocument;
+
+        void expect(ValueType t, const char* what) const {
+            if (type() != t) throw std::domain_error(std::string("jsonpp::LazyValue: not ") + what);
         }
 
-        JSONBooleanType* clone() const {
-            return new JSONBooleanType(*this);
+        // Unescapes the string at q (an opening quote) if needed; returns its bytes through out/data.
+        StringRef string_at(const char* q, std::string& scratch) const {
+            const char* start = q + 1;
+            const char* stop = detail::find_string_special(start, idx->end);
+            if (stop != idx->end && *stop == '"') {
+                detail::check_utf8(start, stop, idx->begin);
+                return StringRef(start, stop - start);
+            }
+
+            scratch.assign(start, stop);
+            stop = detail::unescape(stop, idx->end, scratch, idx->begin);
+            detail::check_utf8(start, stop, idx->begin);
+            return StringRef(scratch);
         }
-    };
 
-    class JSONArray : public JSONValue {
+    public:
+        // Visits the elements of an array or the members of an object in order.
+        class iterator {
+            const detail::LazyIndex* idx;
+            const char* k;
+            const char* v;
+            bool object;
 
-        std::vector<JSONValue*> values;
+            friend class LazyValue;
 
-        void swap(const JSONArray& that) { std::swap(this->values, that.values); }
+            // Positions on the element (and key) starting at q.
+            void enter(const char* q) {
+                if (!object) {
+                    v = q;
+                    return;
+                }
+                if (q == idx->end || *q != '"') throw idx->error("expected object key", q);
+                k = q;
+                q = idx->skip_ws(idx->skip_string(q));
+                if (q == idx->end || *q != ':') throw idx->error("expected ':'", q);
+                v = idx->skip_ws(q + 1);
+                if (v == idx->end) throw idx->error("unexpected end of input", v);
+            }
 
-    public:
-        JSONArray() : JSONValue() {}
+            iterator(const detail::LazyIndex* index, const char* open) : idx(index), k(nullptr), v(nullptr), object(false) {
+                if (!open) return;
+                object = *open == '{';
+                const char* q = idx->skip_ws(open + 1);
+                if (*q == (object ? '}' : ']')) return;
+                enter(q);
+            }
 
-        template <typename InputIterator>
-        JSONArray(InputIterator begin, InputIterator end) : JSONValue(), values(begin, end) {}
+        public:
+            LazyValue operator*() const { return LazyValue(idx, v); }
 
-        JSONArray(const JSONArray& that) {
-            std::transform(that.begin(), that.end(),
-                           std::back_insert_iterator<std::vector<JSONValue*> >(values),
-                           jsonpp::clone
-            );
-        }
+            // The member key, for iterators over objects.
+            std::string key() const {
+                std::string scratch;
+                StringRef str = LazyValue(idx, k).string_at(k, scratch);
+                return std::string(str.data(), str.size());
+            }
 
-        typedef std::vector<JSONValue*>::iterator iterator;
-        typedef std::vector<JSONValue*>::const_iterator const_iterator;
+            bool key_is(StringRef key) const {
+                std::string scratch;
+                StringRef str = LazyValue(idx, k).string_at(k, scratch);
+                return str.size() == key.size() && std::memcmp(str.data(), key.data(), key.size()) == 0;
+            }
 
-        iterator begin() { return values.begin(); }
-        iterator end() {return values.end(); }
-        const_iterator begin() const { return values.begin(); }
-        const_iterator end() const { return values.end(); }
+            iterator& operator++() {
+                const char* q = idx->skip_ws(idx->skip(v));
+                if (*q == ',') {
+                    enter(idx->skip_ws(q + 1));
+                } else if (*q == (object ? '}' : ']')) {
+                    v = nullptr;
+                } else {
+                    throw idx->error("expected ',' or closing bracket", q);
+                }
+                return *this;
+            }
 
-        JSONValue*& operator[](size_t index) { return values[index]; }
-        JSONValue* const & operator[](size_t index) const { return values[index]; }
+            bool operator==(const iterator& that) const { return v == that.v; }
+            bool operator!=(const iterator& that) const { return v != that.v; }
+        };
 
-        size_t size() const {return values.size(); }
+        ValueType type() const {
+            switch (*p) {
+                case '{': return ValueType::OBJECT;
+                case '[': return ValueType::ARRAY;
+                case '"': return ValueType::STRING;
+                case 't':
+                case 'f': return ValueType::BOOLEAN;
+                case 'n': return ValueType::NULL_TYPE;
+                default: return ValueType::NUMBER;
+            }
+        }
 
-        JSONArray& operator=(JSONArray that) {
-            swap(that);
-            return *this;
+        iterator begin() const {
+            if (*p != '{' && *p != '[') throw std::domain_error("jsonpp::LazyValue: not a container");
+            return iterator(idx, p);
         }
 
-        JSONArray* create() const {
-            return new JSONArray();
+        iterator end() const { return iterator(idx, nullptr); }
+
+        size_t size() const {
+            size_t n = 0;
+            for (iterator it = begin(); it != end(); ++it) n++;
+            return n;
         }
 
-        JSONArray* clone() const {
-            return new JSONArray(*this);
+        // Object member lookup; members before the match are skipped, not parsed.
+        bool contains(StringRef key) const {
+            expect(ValueType::OBJECT, "an object");
+            for (iterator it = begin(); it != end(); ++it) {
+                if (it.key_is(key)) return true;
+            }
+            return false;
         }
 
-        ~JSONArray() {
-            for (JSONValue*& ptr : values) {
-                delete ptr;
+        // With duplicate keys the last member wins, as when the object is parsed into a JSONObject, so the
+        // whole object is stepped through.
+        LazyValue operator[](StringRef key) const {
+            expect(ValueType::OBJECT, "an object");
+            iterator found = end();
+            for (iterator it = begin(); it != end(); ++it) {
+                if (it.key_is(key)) found = it;
             }
+            if (found == end()) throw std::out_of_range("jsonpp::LazyValue: no such key");
+            return *found;
+        }
 
-            values.clear();
+        LazyValue operator[](size_t i) const {
+            expect(ValueType::ARRAY, "an array");
+            for (iterator it = begin(); it != end(); ++it) {
+                if (i-- == 0) return *it;
+            }
+            throw std::out_of_range("jsonpp::LazyValue: index out of range");
         }
 
-        std::string to_string() const {
-            std::string out = "[";
+        bool boolean() const {
+            expect(ValueType::BOOLEAN, "a boolean");
+            bool b = *p == 't';
+            const char* word = b ? "true" : "false";
+            size_t len = b ? 4 : 5;
+            if (idx->skip_scalar(p) != p + len || std::memcmp(p, word, len) != 0) throw idx->error("invalid literal", p);
+            return b;
+        }
 
-            for (auto& val : values) {
-                out.append(val->to_string());
-                out.append(", ");
+        template <typename T>
+        T number() const {
+            expect(ValueType::NUMBER, "a number");
+            detail::NumberResult result;
+            const char* q = p;
+            if (!detail::parse_number(q, idx->end, result) || q != idx->skip_scalar(p)) {
+                throw idx->error("invalid number", q);
             }
+            return result.integral ? static_cast<T>(result.integer) : static_cast<T>(result.dbl);
+        }
 
-            out.erase(out.size() - 2);
-
-            out.append("]");
-            return out;
+        std::string str() const {
+            expect(ValueType::STRING, "a string");
+            std::string scratch;
+            StringRef s = string_at(p, scratch);
+            return std::string(s.data(), s.size());
         }
 
+        // The value's source text.
+        StringRef raw() const { return StringRef(p, idx->skip(p) - p); }
+
+        // Builds this subtree as an ordinary heap tree, which the caller owns.
+        JSONValue* materialize(const ParseOptions& options = ParseOptions()) const {
+            return detail::Parser(p, idx->skip(p) - p, nullptr, options, idx->begin).run();
+        }
     };
 
-    class JSONString : public JSONValue {
-        std::string value;
+    // Read-only access to a JSON buffer for callers that only look at part of it. Construction runs the
+    // SIMD structural indexer, checks the bracket structure and records every container's extent;
+    // members, elements and strings are parsed only when read, and everything skipped over is never
+    // parsed at all. The buffer must outlive the document and every LazyValue taken from it.
+    class LazyDocument {
+        detail::LazyIndex idx;
+
+        LazyDocument(const LazyDocument&);
+        LazyDocument& operator=(const LazyDocument&);
 
     public:
-        JSONString() : JSONValue() {}
-        JSONString(const JSONString& that) {
-            value = std::string(that.value);
-        }
+        LazyDocument(const char* data, size_t len) { idx.build(data, len); }
+        explicit LazyDocument(const char* str) { idx.build(str, std::strlen(str)); }
+        explicit LazyDocument(const std::string& str) { idx.build(str.data(), str.size()); }
+        explicit LazyDocument(std::string&&) = delete;
 
-        JSONString(const std::string& str, bool parse=false) {
-            if (!parse) {
-                value = std::string(str);
-            } else {
-                value = jsonpp::parse_str(str);
+        LazyValue root() const { return LazyValue(&idx, idx.top); }
+    };
+
+    // An RFC 6901 JSON Pointer, split into reference tokens once so that it can be resolved against many
+    // documents. Each token keeps its key hash and, if it is an array index, its numeric value; resolving
+    // allocates nothing.
+    class JSONPointer {
+        struct Token {
+            size_t offset;
+            uint32_t len;
+            uint32_t hash;
+            size_t index;
+        };
+
+        static const size_t no_index = static_cast<size_t>(-1);
+
+        std::string keys;
+        std::vector<Token> tokens;
+
+        StringRef text(const Token& t) const { return StringRef(keys.data() + t.offset, t.len); }
+        Key key(const Token& t) const { return Key(text(t), t.hash); }
+
+        // "0" or digits without a leading zero; anything else, including "-", names no element.
+        static size_t parse_index(const char* p, size_t len) {
+            if (len == 0 || len > 18 || (len > 1 && *p == '0')) return no_index;
+            size_t n = 0;
+            for (size_t i = 0; i < len; i++) {
+                if (p[i] < '0' || p[i] > '9') return no_index;
+                n = n * 10 + (p[i] - '0');
             }
+            return n;
         }
 
-        operator std::string() const {
-            return std::string(value);
+        void add_token(size_t offset) {
+            size_t len = keys.size() - offset;
+            if (len > UINT32_MAX) throw std::length_error("jsonpp::JSONPointer: token too long");
+            Token t = {offset, static_cast<uint32_t>(len), detail::key_hash(keys.data() + offset, len),
+                       parse_index(keys.data() + offset, len)};
+            tokens.push_back(t);
         }
 
-        JSONString& operator=(JSONString that) {
-            std::swap(value, that.value);
-            return *this;
+        static const JSONValue* element(const JSONValue* node, size_t index) {
+            if (const JSONArray* arr = dynamic_cast<const JSONArray*>(node)) {
+                return index < arr->size() ? (*arr)[index] : nullptr;
+            }
+
+            const JSONCompactArray& compact = static_cast<const JSONCompactArray&>(*node);
+            if (index >= compact.size()) return nullptr;
+            const JSONValue* held = compact[index].node();
+            if (!held) throw std::domain_error("jsonpp::JSONPointer: element is stored inline in a JSONCompactArray");
+            return held;
+        }
+
+    public:
+        // The empty pointer refers to the whole document; otherwise every token starts with '/', and
+        // '~' is only allowed in the escapes "~0" and "~1". Throws std::invalid_argument if it is malformed.
+        explicit JSONPointer(StringRef pointer) {
+            const char* p = pointer.data();
+            const char* end = p + pointer.size();
+            if (p == end) return;
+            if (*p != '/') throw std::invalid_argument("jsonpp::JSONPointer: pointer must start with '/'");
+
+            keys.reserve(pointer.size());
+            size_t offset = 0;
+            for (++p; p != end; ++p) {
+                if (*p == '/') {
+                    add_token(offset);
+                    offset = keys.size();
+                } else if (*p == '~') {
+                    if (++p == end || (*p != '0' && *p != '1')) throw std::invalid_argument("jsonpp::JSONPointer: invalid '~' escape");
+                    keys += *p == '0' ? '~' : '/';
+                } else {
+                    keys += *p;
+                }
+            }
+            add_token(offset);
         }
 
+        size_t size() const { return tokens.size(); }
+
+        // The unescaped reference token at i.
+        StringRef token(size_t i) const { return text(tokens[i]); }
+
         std::string to_string() const {
-            std::string out = "\"";
-            out.append(jsonpp::escape_str(value));
-            out.append("\"");
+            std::string out;
+            for (const Token& t : tokens) {
+                out += '/';
+                for (size_t i = t.offset; i < t.offset + t.len; i++) {
+                    if (keys[i] == '~') out += "~0";
+                    else if (keys[i] == '/') out += "~1";
+                    else out += keys[i];
+                }
+            }
             return out;
         }
 
-        JSONString* create() const {
-            return new JSONString();
+        // The value this pointer refers to in root, or nullptr if there is none. Throws std::domain_error
+        // if the path runs through a scalar that a JSONCompactArray stores inline, which has no node.
+        const JSONValue* find(const JSONValue* root) const {
+            const JSONValue* node = root;
+            for (const Token& t : tokens) {
+                switch (node->type()) {
+                    case ValueType::OBJECT: {
+                        const JSONObject& obj = static_cast<const JSONObject&>(*node);
+                        JSONObject::const_iterator it = obj.find(key(t));
+                        if (it == obj.end()) return nullptr;
+                        node = it->second;
+                        break;
+                    }
+                    case ValueType::ARRAY:
+                        if (t.index == no_index) return nullptr;
+                        node = element(node, t.index);
+                        if (!node) return nullptr;
+                        break;
+                    default: return nullptr;
+                }
+            }
+            return node;
         }
 
-        JSONString* clone() const {
-            return new JSONString(*this);
+        // Resolves this pointer over a LazyDocument's buffer: members and elements before the target are
+        // stepped over using the structural index, so only the target is read, e.g. by materialize().
+        // Throws std::out_of_range if there is no such value.
+        LazyValue at(const LazyValue& root) const {
+            LazyValue node = root;
+            for (const Token& t : tokens) {
+                ValueType type = node.type();
+                if (type == ValueType::OBJECT) {
+                    node = node[text(t)];
+                } else if (type == ValueType::ARRAY && t.index != no_index) {
+                    node = node[t.index];
+                } else {
+                    throw std::out_of_range("jsonpp::JSONPointer: no such value");
+                }
+            }
+            return node;
         }
     };
 
-    enum class NumberType {
-        FLOAT,
-        INTEGER
-    };
+    template <typename T>
+    class Binding;
 
-    class JSONNumber : public JSONValue {
-        NumberType type;
-        union {
-            double dbl;
-            int64_t integer;
-        } val;
+    namespace detail {
 
-        template <typename T>
-        T get() const {
+        // Cursor that struct bindings decode from. It reads the grammar directly off the buffer, the
+        // way Reader does, but hands values to the fields being filled instead of to a handler.
+        class BindReader {
+            const char* begin;
+            std::string scratch;
 
-        }
-    };
+            static bool is_ws(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
 
-    class JSONObject : public JSONValue {
-        std::map<JSONString, JSONValue*> values;
+            void literal(const char* word, size_t len) {
+                if (static_cast<size_t>(end - p) < len || std::memcmp(p, word, len) != 0) throw error("invalid literal");
+                p += len;
+            }
 
-        void swap(const JSONObject& that) { std::swap(values, that.values); }
+        public:
+            const char* p;
+            const char* end;
 
-    public:
-        JSONObject() : JSONValue() {}
+            BindReader(const char* data, size_t len) : begin(data), p(data), end(data + len) {}
 
-        template <typename InputIterator>
-        JSONObject(InputIterator begin, InputIterator end): JSONValue(), values(begin, end) {}
+            parse_error error(const char* what) const { return parse_error(what, p - begin); }
 
-        JSONObject(const JSONObject& that) {
-            for (auto& pa : that.values) {
-                values[pa.first] = pa.second->clone();
+            // The next byte after any whitespace, or 0 at the end of the input.
+            char peek() {
+                while (p != end && is_ws(*p)) ++p;
+                return p == end ? 0 : *p;
+            }
+
+            void expect(char c, const char* what) {
+                if (peek() != c) throw error(what);
+                ++p;
+            }
+
+            // After the first element or member: consumes a ',' and returns true, or the closing bracket
+            // and returns false.
+            bool more(char close) {
+                char c = peek();
+                if (c == close) {
+                    ++p;
+                    return false;
+                }
+                if (c != ',') throw error("expected ',' or closing bracket");
+                ++p;
+                return true;
+            }
+
+            // Valid until the next string is read.
+            StringRef string() {
+                if (peek() != '"') throw error("expected a string");
+                const char* start = ++p;
+                const char* q = find_string_special(p, end);
+                if (q != end && *q == '"') {
+                    check_utf8(start, q, begin);
+                    p = q + 1;
+                    return StringRef(start, q - start);
+                }
+
+                scratch.assign(start, q);
+                p = unescape(q, end, scratch, begin);
+                if (p == end) throw error("unterminated string");
+                check_utf8(start, p, begin);
+                ++p;
+                return StringRef(scratch);
+            }
+
+            NumberResult number() {
+                peek();
+                NumberResult result;
+                if (!parse_number(p, end, result)) throw error("expected a number");
+                return result;
+            }
+
+            bool boolean() {
+                char c = peek();
+                if (c == 't') literal("true", 4);
+                else if (c == 'f') literal("false", 5);
+                else throw error("expected a boolean");
+                return c == 't';
+            }
+
+            // Checks and steps over a value nobody asked for. Nesting is kept on an explicit stack.
+            void skip() {
+                std::vector<char> open;
+                for (;;) {
+                    char c = peek();
+                    if (c == '{' || c == '[') {
+                        ++p;
+                        char close = c == '{' ? '}' : ']';
+                        if (peek() == close) {
+                            ++p;
+                        } else {
+                            open.push_back(close);
+                            if (close == '}') {
+                                string();
+                                expect(':', "expected ':'");
+                            }
+                            continue;
+                        }
+                    } else if (c == '"') {
+                        string();
+                    } else if (c == 't' || c == 'f') {
+                        boolean();
+                    } else if (c == 'n') {
+                        literal("null", 4);
+                    } else {
+                        number();
+                    }
+
+                    while (!open.empty() && !more(open.back())) open.pop_back();
+                    if (open.empty()) return;
+                    if (open.back() == '}') {
+                        string();
+                        expect(':', "expected ':'");
+                    }
+                }
+            }
+
+            void finish() {
+                if (peek()) throw error("unexpected trailing characters");
+            }
+        };
+
+        inline void bind_read(BindReader& in, bool& out) { out = in.boolean(); }
+
+        // The value of a run of decimal digits, unless it overflows.
+        inline bool digits_value(const char* p, const char* end, uint64_t& out) {
+            uint64_t v = 0;
+            for (; p != end; ++p) {
+                if (!is_digit(*p) || v > (UINT64_MAX - (*p - '0')) / 10) return false;
+                v = v * 10 + static_cast<uint64_t>(*p - '0');
+            }
+            out = v;
+            return true;
+        }
+
+        // Integers must fit the field exactly; floating-point fields also take integers.
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type
+        bind_read(BindReader& in, T& out) {
+            in.peek();
+            const char* at = in.p;
+            NumberResult n = in.number();
+            uint64_t u = 0;
+            bool fits;
+            if (n.integral) {
+                fits = (std::is_signed<T>::value ? n.integer >= static_cast<int64_t>(std::numeric_limits<T>::min()) : n.integer >= 0) &&
+                       (n.integer < 0 || static_cast<uint64_t>(n.integer) <= static_cast<uint64_t>(std::numeric_limits<T>::max()));
+            } else {
+                // Only unsigned 64-bit fields hold integers past INT64_MAX.
+                fits = std::is_unsigned<T>::value && digits_value(at, in.p, u) && u <= static_cast<uint64_t>(std::numeric_limits<T>::max());
+            }
+            if (!fits) {
+                in.p = at;
+                throw in.error("number out of range");
             }
+            out = n.integral ? static_cast<T>(n.integer) : static_cast<T>(u);
         }
 
-        typedef std::map<JSONString, JSONValue*>::iterator iterator;
-        typedef std::map<JSONString, JSONValue*>::const_iterator const_iterator;
+        template <typename T>
+        typename std::enable_if<std::is_floating_point<T>::value>::type bind_read(BindReader& in, T& out) {
+            NumberResult n = in.number();
+            out = static_cast<T>(n.integral ? static_cast<double>(n.integer) : n.dbl);
+        }
 
-        iterator begin() { return values.begin(); }
-        iterator end() {return values.end(); }
-        const_iterator begin() const { return values.begin(); }
-        const_iterator end() const { return values.end(); }
+        inline void bind_read(BindReader& in, std::string& out) {
+            StringRef str = in.string();
+            out.assign(str.data(), str.size());
+        }
 
-        JSONValue*& operator[](std::string index) { return values[index]; }
-        JSONValue* const & operator[](std::string index) const { return values[index]; }
+        // Structs bound with JSONPP_BIND.
+        template <typename T>
+        auto bind_read(BindReader& in, T& out) -> decltype(jsonpp_binding(static_cast<const T*>(nullptr)), void()) {
+            jsonpp_binding(static_cast<const T*>(nullptr)).read(in, out);
+        }
 
-        bool contains(const std::string& key) const { return std::find(begin(), end(), key) != end(); }
-        size_t size() const {return values.size(); }
+        template <typename T, typename A>
+        void bind_read(BindReader& in, std::vector<T, A>& out) {
+            out.clear();
+            in.expect('[', "expected an array");
+            if (in.peek() == ']') {
+                ++in.p;
+                return;
+            }
+            do {
+                out.emplace_back();
+                bind_read(in, out.back());
+            } while (in.more(']'));
+        }
 
-        JSONObject& operator=(JSONObject that) {
-            swap(that);
-            return *this;
+        // std::vector<bool> hands out proxies rather than references, so elements are read aside.
+        template <typename A>
+        void bind_read(BindReader& in, std::vector<bool, A>& out) {
+            out.clear();
+            in.expect('[', "expected an array");
+            if (in.peek() == ']') {
+                ++in.p;
+                return;
+            }
+            do {
+                bool value;
+                bind_read(in, value);
+                out.push_back(value);
+            } while (in.more(']'));
         }
 
-        JSONObject* create() const {
-            return new JSONObject();
+        inline void bind_write(Writer& out, bool value) {
+            if (value) out.write("true", 4);
+            else out.write("false", 5);
         }
 
-        JSONObject* clone() const {
-            return new JSONObject(*this);
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type
+        bind_write(Writer& out, T value) {
+            if (std::is_unsigned<T>::value && static_cast<uint64_t>(value) > static_cast<uint64_t>(INT64_MAX)) {
+                char buf[24];
+                char* end = write_uint(buf, static_cast<uint64_t>(value));
+                out.write(buf, end - buf);
+            } else {
+                write_number(out, static_cast<int64_t>(value));
+            }
         }
 
-        ~JSONObject() {
-            for (auto& pa : values) {
-                delete pa.second;
+        template <typename T>
+        typename std::enable_if<std::is_floating_point<T>::value>::type bind_write(Writer& out, T value) {
+            write_number(out, static_cast<double>(value));
+        }
+
+        inline void bind_write(Writer& out, const std::string& value) {
+            out.put('"');
+            escape_str(value.data(), value.size(), out);
+            out.put('"');
+        }
+
+        template <typename T>
+        auto bind_write(Writer& out, const T& value) -> decltype(jsonpp_binding(static_cast<const T*>(nullptr)), void()) {
+            jsonpp_binding(static_cast<const T*>(nullptr)).write(out, value);
+        }
+
+        template <typename T, typename A>
+        void bind_write(Writer& out, const std::vector<T, A>& values) {
+            out.open('[');
+            for (size_t i = 0; i < values.size(); i++) {
+                out.separator(i == 0);
+                bind_write(out, static_cast<const T&>(values[i]));
             }
+            out.close(']', values.empty());
+        }
 
-            values.clear();
+        template <typename C, typename M, M C::*member>
+        void read_field(BindReader& in, C& obj) { bind_read(in, obj.*member); }
+
+        template <typename C, typename M, M C::*member>
+        void write_field(Writer& out, const C& obj) { bind_write(out, obj.*member); }
+
+    }
+
+    // The fields of a struct bound with JSONPP_BIND, in declaration order, with their key names.
+    template <typename T>
+    class Binding {
+    public:
+        struct Field {
+            const char* name;
+            size_t len;
+            void (*read)(detail::BindReader&, T&);
+            void (*write)(Writer&, const T&);
+        };
+
+    private:
+        const Field* fields;
+        size_t count;
+        // Open-addressed table of field index + 1 (0 when empty), keyed by slot_hash().
+        std::vector<size_t> slots;
+        size_t mask;
+
+        // Length, first and last character tell most field names apart without reading the rest.
+        static size_t slot_hash(const char* name, size_t len) {
+            if (len == 0) return 0;
+            return len * 31 + static_cast<unsigned char>(name[0]) * 7 + static_cast<unsigned char>(name[len - 1]);
         }
 
-        std::string to_string() const {
-            std::string out = "{";
+        bool is(const Field& f, StringRef key) const {
+            return f.len == key.size() && std::memcmp(f.name, key.data(), f.len) == 0;
+        }
+
+        // Members usually arrive in declaration order, so the field after the previous match is tried
+        // first; otherwise the key is looked up in the table.
+        const Field* find(StringRef key, size_t& next) const {
+            if (next < count && is(fields[next], key)) return &fields[next++];
+            for (size_t s = slot_hash(key.data(), key.size()) & mask; slots[s]; s = (s + 1) & mask) {
+                const Field& f = fields[slots[s] - 1];
+                if (is(f, key)) {
+                    next = slots[s];
+                    return &f;
+                }
+            }
+            return nullptr;
+        }
 
-            for (auto& pa : this->values) {
-                out.append(pa.first.to_string());
-                out.append(pa.second->to_string());
+    public:
+        Binding(const Field* fields, size_t count) : fields(fields), count(count) {
+            size_t n = 4;
+            while (n < 2 * count) n *= 2;
+            slots.assign(n, 0);
+            mask = n - 1;
+            for (size_t i = 0; i < count; i++) {
+                size_t s = slot_hash(fields[i].name, fields[i].len) & mask;
+                while (slots[s]) s = (s + 1) & mask;
+                slots[s] = i + 1;
             }
+        }
 
-            out.erase(out.length() - 2);
+        size_t size() const { return count; }
+        const Field& operator[](size_t i) const { return fields[i]; }
 
-            out.append("}");
-            return out;
+        // Fills the fields named in the object at in. Fields it does not mention keep their values, and
+        // members with no matching field are checked and skipped.
+        void read(detail::BindReader& in, T& out) const {
+            in.expect('{', "expected an object");
+            if (in.peek() == '}') {
+                ++in.p;
+                return;
+            }
+
+            size_t next = 0;
+            do {
+                StringRef key = in.string();
+                const Field* field = find(key, next);
+                in.expect(':', "expected ':'");
+                if (field) field->read(in, out);
+                else in.skip();
+            } while (in.more('}'));
         }
 
+        void write(Writer& out, const T& value) const {
+            out.open('{');
+            for (size_t i = 0; i < count; i++) {
+                out.separator(i == 0);
+                out.put('"');
+                out.write(fields[i].name, fields[i].len);
+                out.put('"');
+                out.key_separator();
+                fields[i].write(out, value);
+            }
+            out.close('}', count == 0);
+        }
     };
 
+    // Decodes [data, data + len) straight into value, without building a tree. value may be a struct
+    // bound with JSONPP_BIND, a std::vector of bindable values, a std::string, a bool or a number.
+    // Throws parse_error on malformed input or a member whose JSON type does not match its field.
+    template <typename T>
+    void from_json(const char* data, size_t len, T& value) {
+        detail::BindReader in(data, len);
+        detail::bind_read(in, value);
+        in.finish();
+    }
+
+    template <typename T>
+    void from_json(const std::string& str, T& value) { from_json(str.data(), str.size(), value); }
+
+    template <typename T>
+    void to_json(const T& value, Writer& out) { detail::bind_write(out, value); }
+
+    template <typename T>
+    std::string to_json(const T& value, const Format& format = Format()) {
+        std::string out;
+        StringWriter writer(out);
+        writer.set_format(format);
+        detail::bind_write(writer, value);
+        return out;
+    }
+
 }
 
+#define JSONPP_DETAIL_EXPAND(x) x
+#define JSONPP_DETAIL_CAT_(a, b) a##b
+#define JSONPP_DETAIL_CAT(a, b) JSONPP_DETAIL_CAT_(a, b)
+#define JSONPP_DETAIL_COUNT_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, N, ...) N
+#define JSONPP_DETAIL_COUNT(...) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_COUNT_(__VA_ARGS__, 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1))
+#define JSONPP_DETAIL_EACH_1(m, t, a) m(t, a)
+#define JSONPP_DETAIL_EACH_2(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_1(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_3(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_2(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_4(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_3(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_5(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_4(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_6(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_5(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_7(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_6(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_8(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_7(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_9(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_8(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_10(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_9(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_11(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_10(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_12(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_11(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_13(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_12(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_14(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_13(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_15(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_14(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_16(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_15(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_17(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_16(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_18(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_17(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_19(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_18(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_20(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_19(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_21(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_20(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_22(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_21(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_23(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_22(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_24(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_23(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_25(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_24(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_26(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_25(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_27(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_26(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_28(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_27(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_29(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_28(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_30(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_29(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_31(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_30(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH_32(m, t, a, ...) m(t, a) JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_EACH_31(m, t, __VA_ARGS__))
+#define JSONPP_DETAIL_EACH(m, t, ...) \
+        JSONPP_DETAIL_EXPAND(JSONPP_DETAIL_CAT(JSONPP_DETAIL_EACH_, JSONPP_DETAIL_COUNT(__VA_ARGS__))(m, t, __VA_ARGS__))
+
+#define JSONPP_DETAIL_FIELD(T, f) \
+        {#f, sizeof(#f) - 1, &::jsonpp::detail::read_field<T, decltype(T::f), &T::f>, \
+         &::jsonpp::detail::write_field<T, decltype(T::f), &T::f>},
+
+// Describes the fields of struct T for from_json() and to_json(), which then read and write it
+// directly. Use it once in T's namespace, after T is complete; each field keeps its own name as its
+// JSON key. Up to 32 fields are supported.
+#define JSONPP_BIND(T, ...) \
+    inline const ::jsonpp::Binding<T>& jsonpp_binding(const T*) { \
+        static const ::jsonpp::Binding<T>::Field fields[] = {JSONPP_DETAIL_EACH(JSONPP_DETAIL_FIELD, T, __VA_ARGS__)}; \
+        static const ::jsonpp::Binding<T> binding(fields, sizeof(fields) / sizeof(fields[0])); \
+        return binding; \
+    }
+
 #endif //TCAT_JSONPP_HPP
@@ -2,3 +2,1693 @@
 // Created by Nicholas on 7/27/2016.
 //
 
+#include "jsonpp.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <utility>
+
+using namespace jsonpp;
+
+static bool parse_fails(const std::string& text) {
+    try {
+        delete parse(text);
+    } catch (const parse_error&) {
+        return true;
+    }
+    return false;
+}
+
+static void test_parse() {
+    std::unique_ptr<JSONValue> root(parse(" {\"a\": [1, -2, 3.5, true, false, null], \"b\": \"x\\n\\u00e9\"} "));
+    JSONObject* obj = dynamic_cast<JSONObject*>(root.get());
+    assert(obj && obj->size() == 2);
+    assert(obj->contains("a") && !obj->contains("c"));
+
+    JSONArray* arr = dynamic_cast<JSONArray*>((*obj)["a"]);
+    assert(arr && arr->size() == 6);
+    assert(dynamic_cast<JSONNumber*>((*arr)[0])->get<int>() == 1);
+    assert(dynamic_cast<JSONNumber*>((*arr)[1])->get<int64_t>() == -2);
+    assert(dynamic_cast<JSONNumber*>((*arr)[2])->get<double>() == 3.5);
+    assert(dynamic_cast<JSONBooleanType*>((*arr)[3])->get());
+    assert(!dynamic_cast<JSONBooleanType*>((*arr)[4])->get());
+    assert(dynamic_cast<JSONNullType*>((*arr)[5]));
+
+    assert(std::string(*dynamic_cast<JSONString*>((*obj)["b"])) == "x\n\xc3\xa9");
+    assert(parse_str("\\ud83d\\ude00") == "\xf0\x9f\x98\x80");
+
+    assert(dynamic_cast<JSONNumber*>(std::unique_ptr<JSONValue>(parse("-9223372036854775808")).get())
+                   ->number_type() == NumberType::INTEGER);
+    assert(dynamic_cast<JSONNumber*>(std::unique_ptr<JSONValue>(parse("9223372036854775808")).get())
+                   ->number_type() == NumberType::FLOAT);
+
+    std::string deep(100000, '[');
+    deep.append(100000, ']');
+    delete parse(deep);
+
+    assert(parse_fails(""));
+    assert(parse_fails("[1,]"));
+    assert(parse_fails("{\"a\" 1}"));
+    assert(parse_fails("[1] 2"));
+    assert(parse_fails("01"));
+    assert(parse_fails("\"abc"));
+    assert(parse_fails("[\"\\q\"]"));
+    assert(parse_fails("tru"));
+}
+
+static void test_string_scan() {
+    const char specials[] = {'"', '\\', '\n', '\x01'};
+    for (size_t len = 0; len < 80; len++) {
+        std::string clean(len, 'a');
+        clean.append("\xc3\xa9");
+        assert(detail::find_string_special(clean.data(), clean.data() + clean.size()) == clean.data() + clean.size());
+
+        for (char c : specials) {
+            std::string s = clean;
+            s.push_back(c);
+            s.append(40, 'b');
+            assert(detail::find_string_special(s.data(), s.data() + s.size()) == s.data() + len + 2);
+        }
+    }
+
+    std::string body(100, 'x');
+    body.append("\\t");
+    body.append(100, 'y');
+    std::string expected(100, 'x');
+    expected.push_back('\t');
+    expected.append(100, 'y');
+    assert(std::string(JSONString(body, true)) == expected);
+}
+
+static void test_escape() {
+    std::string raw("a\"b\\c/d\x01\x00\xc3\xa9\n", 12);
+    assert(escape_str(raw) == "a\\\"b\\\\c\\/d\\u0001\\u0000\xc3\xa9\\n");
+
+    std::string all;
+    for (int i = 0; i < 3; i++) {
+        for (int c = 0; c < 128; c++) all.push_back(static_cast<char>(c));
+    }
+    assert(parse_str(escape_str(all)) == all);
+    assert(JSONString(all).to_string() == "\"" + escape_str(all) + "\"");
+}
+
+static void test_serialize() {
+    std::unique_ptr<JSONValue> root(parse("{\"a\": [1, 2.5, \"x\"], \"b\": {}, \"c\": [], \"d\": null}"));
+    const std::string expected = "{\"a\": [1, 2.5, \"x\"], \"b\": {}, \"c\": [], \"d\": null}";
+    assert(root->to_string() == expected);
+
+    std::string appended = "prefix:";
+    StringWriter sw(appended);
+    root->serialize(sw);
+    assert(appended == "prefix:" + expected);
+
+    char small[8];
+    BufferWriter bw(small, sizeof(small));
+    root->serialize(bw);
+    assert(bw.overflowed() && bw.size() == expected.size());
+    assert(std::string(small, sizeof(small)) == expected.substr(0, sizeof(small)));
+
+    std::vector<char> exact(bw.size());
+    BufferWriter fits(exact.data(), exact.size());
+    root->serialize(fits);
+    assert(!fits.overflowed() && std::string(exact.begin(), exact.end()) == expected);
+}
+
+static void test_document() {
+    const std::string text = "{\"name\": \"a\\tb\", \"list\": [1, {\"k\": \"v\"}, [], \"long string value\"], \"name\": true}";
+
+    Document doc(64);
+    for (int round = 0; round < 3; round++) {
+        JSONObject* obj = dynamic_cast<JSONObject*>(doc.parse(text));
+        assert(obj && obj->arena() == &doc.arena());
+        assert(obj->size() == 2 && dynamic_cast<JSONBooleanType*>((*obj)["name"])->get());
+
+        JSONArray* list = dynamic_cast<JSONArray*>((*obj)["list"]);
+        assert(list->size() == 4 && list->arena() == &doc.arena());
+        list->push_back(doc.make_string("added"));
+        list->push_back(doc.make<JSONNumber>(7));
+        assert(doc.root()->to_string() ==
+               "{\"name\": true, \"list\": [1, {\"k\": \"v\"}, [], \"long string value\", \"added\", 7]}");
+
+        std::unique_ptr<JSONValue> kept(list->clone());
+        doc.clear();
+        assert(kept->to_string() == "[1, {\"k\": \"v\"}, [], \"long string value\", \"added\", 7]");
+    }
+
+    bool failed = false;
+    try {
+        doc.parse("[1, 2, {\"a\": ");
+    } catch (const parse_error& e) {
+        failed = e.offset() == 13;
+    }
+    assert(failed);
+
+    JSONObject* built = doc.make_object();
+    built->insert(JSONString("key", 3, &doc.arena()), doc.make<JSONNullType>());
+    doc.set_root(built);
+    assert(doc.root()->to_string() == "{\"key\": null}");
+}
+
+static void test_compact() {
+    static_assert(sizeof(Value) == 16, "Value must stay 16 bytes");
+
+    const std::string text = "[1, -2.5, true, null, \"short\", \"a string longer than fourteen\", [3, {\"k\": [4]}], \"e\\u00e9\"]";
+    ParseOptions options;
+    options.compact_arrays = true;
+
+    std::unique_ptr<JSONValue> root(parse(text, options));
+    JSONCompactArray* arr = dynamic_cast<JSONCompactArray*>(root.get());
+    assert(arr && arr->size() == 8 && arr->type() == ValueType::ARRAY);
+    assert((*arr)[0].number<int>() == 1 && (*arr)[0].number_type() == NumberType::INTEGER);
+    assert((*arr)[1].number<double>() == -2.5);
+    assert((*arr)[2].boolean() && (*arr)[3].type() == ValueType::NULL_TYPE);
+    assert((*arr)[4].str() == "short" && (*arr)[5].str() == "a string longer than fourteen");
+    assert((*arr)[6].type() == ValueType::ARRAY && dynamic_cast<JSONCompactArray*>((*arr)[6].node()));
+    assert((*arr)[7].str() == "e\xc3\xa9");
+
+    const std::string expected = "[1, -2.5, true, null, \"short\", \"a string longer than fourteen\", [3, {\"k\": [4]}], \"e\xc3\xa9\"]";
+    assert(root->to_string() == expected);
+    std::unique_ptr<JSONValue> copy(root->clone());
+    assert(copy->to_string() == expected);
+
+    Document doc;
+    assert(doc.parse(text, options)->to_string() == expected);
+
+    std::unique_ptr<JSONValue> plain(parse(text));
+    assert(JSONCompactArray(*dynamic_cast<JSONArray*>(plain.get())).to_string() == expected);
+
+    std::string deep(50000, '[');
+    deep.append(50000, ']');
+    delete parse(deep, options);
+}
+
+static double parsed_double(const std::string& text) {
+    std::unique_ptr<JSONValue> v(parse(text));
+    return dynamic_cast<JSONNumber*>(v.get())->get<double>();
+}
+
+static void test_numbers() {
+    assert(JSONNumber(1.0).to_string() == "1.0");
+    assert(JSONNumber(-0.0).to_string() == "-0.0");
+    assert(JSONNumber(0.1).to_string() == "0.1");
+    assert(JSONNumber(1e21).to_string() == "1e+21");
+    assert(JSONNumber(1.5e-7).to_string() == "1.5e-7");
+    assert(JSONNumber(123456.789).to_string() == "123456.789");
+    assert(JSONNumber(5e-324).to_string() == "5e-324");
+    assert(JSONNumber(1.7976931348623157e308).to_string() == "1.7976931348623157e+308");
+    assert(JSONNumber(INT64_MIN).to_string() == "-9223372036854775808");
+    // Unsigned values past INT64_MAX become the nearest double rather than wrapping negative.
+    assert(JSONNumber(static_cast<uint64_t>(INT64_MAX)).to_string() == "9223372036854775807");
+    assert(JSONNumber(UINT64_MAX).to_string() == "1.8446744073709552e+19");
+    JSONCompactArray wide;
+    wide.push_back(Value(UINT64_MAX));
+    wide.push_back(Value(uint64_t(1)));
+    assert(wide.to_string() == "[1.8446744073709552e+19, 1]");
+    assert(JSONNumber(std::numeric_limits<double>::infinity()).to_string() == "null");
+
+    assert(parsed_double("0.1") == 0.1);
+    assert(parsed_double("1e23") == 1e23);
+    assert(parsed_double("2.2250738585072011e-308") == 2.2250738585072011e-308);
+    assert(parsed_double("4.9406564584124654e-324") == 5e-324);
+    assert(parsed_double("2.4703282292062328e-324") == 5e-324);
+    assert(parsed_double("2.4703282292062327e-324") == 0.0);
+    assert(parsed_double("1e400") == std::numeric_limits<double>::infinity());
+    assert(parsed_double("12345678901234567890") == 12345678901234567890.0);
+    assert(parsed_double("9007199254740993") == 9007199254740992.0);
+    assert(parsed_double("1.00000000000000011102230246251565404236316680908203125") == 1.0);
+    assert(parsed_double("1.00000000000000011102230246251565404236316680908203126") == 1.0000000000000002);
+
+    std::string many = "0.";
+    many.append(400, '0');
+    many.append("1e400");
+    assert(parsed_double(many) == 1e-1);
+
+    std::unique_ptr<JSONValue> ints(parse("[12345678, 1234567812345678, -9223372036854775808, 9223372036854775807]"));
+    JSONArray* arr = dynamic_cast<JSONArray*>(ints.get());
+    assert(dynamic_cast<JSONNumber*>((*arr)[0])->get<int64_t>() == 12345678);
+    assert(dynamic_cast<JSONNumber*>((*arr)[1])->get<int64_t>() == 1234567812345678LL);
+    assert(dynamic_cast<JSONNumber*>((*arr)[2])->get<int64_t>() == INT64_MIN);
+    assert(dynamic_cast<JSONNumber*>((*arr)[3])->get<int64_t>() == INT64_MAX);
+
+    uint64_t state = 88172645463325252ULL;
+    for (int i = 0; i < 100000; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        double d = detail::bits_to_double(state);
+        if (!std::isfinite(d)) continue;
+        assert(parsed_double(JSONNumber(d).to_string()) == d);
+    }
+}
+
+static void test_object() {
+    std::string text = "{";
+    for (int i = 99; i >= 0; i--) {
+        text += "\"key" + std::to_string(i) + "\": " + std::to_string(i) + (i ? ", " : "");
+    }
+    text += ", \"key50\": -1}";
+
+    for (int round = 0; round < 2; round++) {
+        Document doc;
+        std::unique_ptr<JSONValue> heap;
+        JSONObject* obj = dynamic_cast<JSONObject*>(round ? doc.parse(text) : (heap.reset(parse(text)), heap.get()));
+        assert(obj->size() == 100);
+        assert(obj->begin()->first == JSONString("key99") && (obj->end() - 1)->first == JSONString("key0"));
+        for (int i = 0; i < 100; i++) {
+            int expected = i == 50 ? -1 : i;
+            assert(dynamic_cast<JSONNumber*>((*obj)["key" + std::to_string(i)])->get<int>() == expected);
+        }
+        assert(!obj->contains("key100") && obj->find("key") == obj->end());
+
+        std::unique_ptr<JSONObject> copy(obj->clone());
+        assert(copy->contains("key7") && copy->to_string() == obj->to_string());
+    }
+
+    static const Key hot("key42");
+    std::unique_ptr<JSONObject> built(new JSONObject());
+    for (int i = 0; i < 200; i++) {
+        built->insert(JSONString("key" + std::to_string(i)), new JSONNumber(i));
+        for (int j = 0; j <= i; j += 7) assert(built->contains("key" + std::to_string(j)));
+        assert(built->contains(hot) == (i >= 42));
+    }
+    assert(dynamic_cast<const JSONNumber*>((*static_cast<const JSONObject*>(built.get()))[hot])->get<int>() == 42);
+    assert(built->find(StringRef("key199", 6))->second == (*built)["key199"]);
+
+    JSONObject small;
+    small.insert(JSONString("b"), new JSONNumber(1));
+    small.insert(JSONString("a"), new JSONNumber(2));
+    small.insert(JSONString("b"), new JSONNumber(3));
+    assert(small.to_string() == "{\"b\": 3, \"a\": 2}");
+}
+
+static void test_key_pool() {
+    const std::string text = "[{\"id\": 1, \"name\": \"a\"}, {\"id\": 2, \"name\": \"b\", \"n\\u0061me2\": 0}]";
+
+    for (int shared = 0; shared < 2; shared++) {
+        KeyPool pool(shared != 0);
+        ParseOptions options;
+        options.key_pool = &pool;
+
+        std::unique_ptr<JSONValue> heap(parse(text, options));
+        Document doc;
+        doc.parse(text, options);
+        assert(heap->to_string() == doc.root()->to_string());
+        assert(pool.size() == 3);
+
+        JSONArray* arr = dynamic_cast<JSONArray*>(heap.get());
+        JSONObject* first = dynamic_cast<JSONObject*>((*arr)[0]);
+        JSONObject* second = dynamic_cast<JSONObject*>((*arr)[1]);
+        assert(first->begin()->first.data() == second->begin()->first.data());
+
+        Key id = pool.key("id");
+        assert(id.data() == first->begin()->first.data());
+        assert(dynamic_cast<const JSONNumber*>((*static_cast<const JSONObject*>(second))[id])->get<int>() == 2);
+        assert(second->contains("name2"));
+
+        std::unique_ptr<JSONValue> copy(heap->clone());
+        heap.reset();
+        assert(copy->to_string() == doc.root()->to_string());
+    }
+}
+
+static void test_borrow_strings() {
+    std::string text = "{\"plain\": \"a fairly long string value\", \"esc\\n\": \"tab\\there\", "
+                       "\"list\": [\"another long borrowed string\", \"short\"]}";
+    const char* lo = text.data();
+    const char* hi = lo + text.size();
+
+    for (int compact = 0; compact < 2; compact++) {
+        ParseOptions options;
+        options.borrow_strings = true;
+        options.compact_arrays = compact != 0;
+
+        std::unique_ptr<JSONValue> tree(parse(text, options));
+        JSONObject* obj = dynamic_cast<JSONObject*>(tree.get());
+        const JSONObject::member& plain = *obj->begin();
+        assert(plain.first.data() >= lo && plain.first.data() < hi);
+
+        const JSONString* value = dynamic_cast<JSONString*>(plain.second);
+        assert(value->data() >= lo && value->data() < hi);
+        assert(std::string(*value) == "a fairly long string value");
+
+        const JSONObject::member& esc = *(obj->begin() + 1);
+        assert(!(esc.first.data() >= lo && esc.first.data() < hi));
+        assert(std::string(esc.first) == "esc\n");
+        assert(std::string(*dynamic_cast<JSONString*>(esc.second)) == "tab\there");
+
+        if (compact) {
+            JSONCompactArray* list = dynamic_cast<JSONCompactArray*>((*obj)["list"]);
+            assert((*list)[0].data() >= lo && (*list)[0].data() < hi);
+            assert((*list)[0].str() == "another long borrowed string");
+        }
+
+        std::string expected = tree->to_string();
+        std::unique_ptr<JSONValue> copy(tree->clone());
+        tree.reset();
+        text.assign(text.size(), 'x');
+        assert(copy->to_string() == expected);
+        text = "{\"plain\": \"a fairly long string value\", \"esc\\n\": \"tab\\there\", "
+               "\"list\": [\"another long borrowed string\", \"short\"]}";
+    }
+}
+
+// Byte-at-a-time model of the stage-1 indexer.
+static std::vector<uint32_t> reference_structurals(const std::string& text) {
+    std::vector<uint32_t> out;
+    bool in_string = false, escaped = false, prev_scalar = false;
+    for (size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        bool quote = c == '"' && !escaped;
+        bool ws = c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        bool op = std::strchr("{}[]:,", c) && c;
+        bool scalar = !ws && !op;
+
+        bool in_after = in_string != quote;
+        bool tail = in_after != quote;
+        if ((op || (scalar && !prev_scalar)) && !tail) out.push_back(static_cast<uint32_t>(i));
+
+        in_string = in_after;
+        prev_scalar = scalar && !quote;
+        escaped = c == '\\' && !escaped;
+    }
+    return out;
+}
+
+static void test_structural_index() {
+    std::vector<uint32_t> tape;
+    detail::structural_index("{\"a\\\"\": [1, true], \"b\": \"x y\"}", 30, tape);
+    const uint32_t expected[] = {0, 1, 6, 8, 9, 10, 12, 16, 17, 19, 22, 24, 29};
+    assert(tape == std::vector<uint32_t>(expected, expected + 13));
+
+    std::vector<detail::classify_fn> kernels;
+    kernels.push_back(&detail::classify_scalar);
+    kernels.push_back(detail::structural_kernel());
+#if defined(JSONPP_SSE2)
+    kernels.push_back(&detail::classify_sse2);
+#endif
+#if defined(JSONPP_DISPATCH)
+    if (__builtin_cpu_supports("avx2")) kernels.push_back(&detail::classify_avx2);
+#endif
+
+    const char alphabet[] = "\\\"{}[]:, \n\tax1";
+    uint32_t seed = 12345;
+    for (int round = 0; round < 4000; round++) {
+        std::string text;
+        size_t len = round % 300;
+        for (size_t i = 0; i < len; i++) {
+            seed = seed * 1103515245 + 12345;
+            // Backslash and quote runs are what exercise the carries; weight them up.
+            unsigned r = (seed >> 16) % 24;
+            text.push_back(r < 4 ? '\\' : r < 7 ? '"' : alphabet[r % (sizeof(alphabet) - 1)]);
+        }
+
+        std::vector<uint32_t> expect = reference_structurals(text);
+        bool open_string = false;
+        try {
+            std::vector<uint32_t> ignored;
+            detail::structural_index(text.data(), text.size(), ignored, &detail::classify_scalar);
+        } catch (const parse_error&) {
+            open_string = true;
+        }
+
+        for (detail::classify_fn kernel : kernels) {
+            std::vector<uint32_t> got;
+            bool threw = false;
+            try {
+                detail::structural_index(text.data(), text.size(), got, kernel);
+            } catch (const parse_error&) {
+                threw = true;
+            }
+            assert(threw == open_string);
+            if (!threw) assert(got == expect);
+        }
+    }
+}
+
+// The tree parse() builds from text, or the error it throws.
+static std::string parse_outcome(const std::string& text, const ParseOptions& options) {
+    try {
+        std::unique_ptr<JSONValue> tree(parse(text, options));
+        return tree->to_string();
+    } catch (const parse_error& e) {
+        return e.message() + " @" + std::to_string(e.offset());
+    }
+}
+
+static void test_indexed_parse() {
+    ParseOptions indexed;
+    indexed.indexed = true;
+    const char* docs[] = {
+        " {\"a\\\"\": [1, true , -2.5e3 ],\n\t\"b\": {\"c\" :null, \"d\":[[], {}]}, \"e\": \"x\\\\\"} ",
+        "\"top\"", "  42  ", "[\"\\u00e9\", \"caf\xc3\xa9\"]", "[1 2]", "[truex]", "[1\"a\"]", "{\"a\" 1}",
+        "[1,]", "[\"open", "[1] [2]", "", "   ", "[nul l]", "{\"a\": \"b\" \"c\"}", "[\"\\q\"]", "[\"a\"1]"};
+    for (const char* doc : docs) assert(parse_outcome(doc, indexed) == parse_outcome(doc, ParseOptions()));
+
+    // Random token soup, nearly all of it malformed: both readers fail the same way at the same place.
+    const char* tokens[] = {"{", "}", "[", "]", ":", ",", " ", "\n  ", "\"k\"", "\"a\\\"b\"", "\"", "\\", "1",
+                            "-0.5e2", "true", "null", "x"};
+    uint32_t seed = 777;
+    for (int round = 0; round < 3000; round++) {
+        std::string text;
+        for (int i = round % 40; i > 0; i--) {
+            seed = seed * 1103515245 + 12345;
+            text += tokens[(seed >> 16) % (sizeof(tokens) / sizeof(tokens[0]))];
+        }
+        assert(parse_outcome(text, indexed) == parse_outcome(text, ParseOptions()));
+    }
+
+    // Pretty-printed documents are where skipping whitespace by the tape matters.
+    std::string pretty = "{\"list\": [";
+    for (int i = 0; i < 500; i++) pretty += std::string(i ? "," : "") + "\n        {\"id\": " + std::to_string(i) + "}";
+    pretty += "\n]}";
+    assert(parse_outcome(pretty, indexed) == parse_outcome(pretty, ParseOptions()));
+
+    ParseLimits bytes;
+    bytes.max_bytes = 4;
+    indexed.limits = bytes;
+    assert(parse_outcome("[1, 2]", indexed) == "input too large @4");
+}
+
+static void test_lazy() {
+    const std::string text = " {\"skip\": [1, [2, {\"x\": \"]}\"}], 3], \"name\": \"al\\\"ice\", "
+                             "\"k\\u0065y\": true, \"n\": -12.5e1, \"list\": [10, 20, 30], \"nil\": null} ";
+    LazyDocument doc(text);
+    LazyValue root = doc.root();
+    assert(root.type() == ValueType::OBJECT);
+    assert(root.size() == 6);
+    assert(root["name"].str() == "al\"ice");
+    assert(root["key"].boolean());
+    assert(root["n"].number<double>() == -125.0);
+    assert(root["list"].size() == 3);
+    assert(root["list"][2].number<int>() == 30);
+    assert(root["nil"].type() == ValueType::NULL_TYPE);
+    assert(!root.contains("x"));
+    assert(root["skip"][1][1]["x"].str() == "]}");
+    assert(std::string(root["skip"].raw().data(), root["skip"].raw().size()) == "[1, [2, {\"x\": \"]}\"}], 3]");
+
+    std::unique_ptr<JSONValue> list(root["list"].materialize());
+    assert(list->to_string() == "[10, 20, 30]");
+
+    std::string keys;
+    for (LazyValue::iterator it = root.begin(); it != root.end(); ++it) keys += it.key() + ",";
+    assert(keys == "skip,name,key,n,list,nil,");
+
+    bool missing = false;
+    try {
+        root["nope"];
+    } catch (const std::out_of_range&) {
+        missing = true;
+    }
+    assert(missing);
+
+    // Duplicate keys: the last member wins, as in the DOM.
+    const std::string dup_text = "{\"a\": 1, \"b\": 0, \"a\": [2], \"a\": {\"c\": 3}}";
+    std::unique_ptr<JSONValue> dup_dom(parse(dup_text));
+    LazyDocument dup(dup_text);
+    std::unique_ptr<JSONValue> last(dup.root()["a"].materialize());
+    assert(last->to_string() == (*dynamic_cast<const JSONObject*>(dup_dom.get()))["a"]->to_string());
+    assert(last->to_string() == "{\"c\": 3}");
+
+    assert(LazyDocument("\"top\"").root().str() == "top");
+    assert(LazyDocument("42").root().number<int>() == 42);
+
+    const char* bad[] = {"", "[1, 2", "[1}", "{\"a\": 1}}", "[\"open]", "[] x"};
+    for (const char* b : bad) {
+        bool threw = false;
+        try {
+            LazyDocument d(b, std::strlen(b));
+        } catch (const parse_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+
+    // Errors inside values surface when the value is read, with document offsets.
+    const std::string sloppy_text = "[1, tru, 1x, [2 3]]";
+    LazyDocument sloppy(sloppy_text);
+    bool threw = false;
+    try {
+        sloppy.root()[1].boolean();
+    } catch (const parse_error& e) {
+        threw = e.offset() == 4;
+    }
+    assert(threw);
+    threw = false;
+    try {
+        sloppy.root()[2].number<int>();
+    } catch (const parse_error&) {
+        threw = true;
+    }
+    assert(threw);
+    threw = false;
+    try {
+        sloppy.root()[3].size();
+    } catch (const parse_error& e) {
+        threw = e.offset() == 16;
+    }
+    assert(threw);
+}
+
+static void test_push_parser() {
+    const std::string text = "{\"a\": [1, -2.5e3, true, false, null], \"s\\u00e9\": \"x\\\"y\\uD83D\\uDE00z\", "
+                             "\"o\": {\"k\": {}, \"l\": []}, \"n\": 12345678901234}";
+    std::unique_ptr<JSONValue> expected(parse(text));
+
+    std::vector<std::unique_ptr<JSONValue> > out;
+    PushParser parser([&out](JSONValue* v) { out.push_back(std::unique_ptr<JSONValue>(v)); });
+
+    // Every two-piece split, then one byte at a time.
+    for (size_t cut = 0; cut <= text.size(); cut++) {
+        out.clear();
+        parser.feed(text.data(), cut);
+        parser.feed(text.data() + cut, text.size() - cut);
+        parser.finish();
+        assert(out.size() == 1 && out[0]->to_string() == expected->to_string());
+    }
+    out.clear();
+    for (char c : text) parser.feed(&c, 1);
+    parser.finish();
+    assert(out.size() == 1 && out[0]->to_string() == expected->to_string());
+
+    // A stream of top-level values, with a bare number that only finish() can complete.
+    out.clear();
+    parser.feed("{\"id\": 1}\n[2]\n\"three\"\n4");
+    assert(out.size() == 3);
+    parser.finish();
+    assert(out.size() == 4 && out[3]->to_string() == "4");
+
+    // Split depth 1: elements arrive one by one and the outer array is never built.
+    std::vector<std::string> items;
+    PushParser elements([&items](JSONValue* v) {
+        items.push_back(v->to_string());
+        delete v;
+    }, 1);
+    elements.feed("[{\"a\": [1]}, 2");
+    assert(items.size() == 1 && items[0] == "{\"a\": [1]}");
+    elements.feed(", \"x\"]");
+    elements.finish();
+    assert(items.size() == 3 && items[1] == "2" && items[2] == "\"x\"");
+
+    const char* bad[] = {"[1,]", "{\"a\" 1}", "[tru]", "[1 2]", "[\"a\\q\"]", "[-]", "}"};
+    const size_t offsets[] = {3, 5, 1, 3, 4, 2, 0};
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        PushParser strict([](JSONValue* v) { delete v; });
+        size_t offset = 0;
+        try {
+            strict.feed(bad[i], 2);
+            strict.feed(bad[i] + 2, std::strlen(bad[i]) - 2);
+            strict.finish();
+            assert(false);
+        } catch (const parse_error& e) {
+            offset = e.offset();
+        }
+        assert(offset == offsets[i]);
+    }
+
+    PushParser truncated([](JSONValue* v) { delete v; });
+    truncated.feed("[1, {\"a\": \"b");
+    bool threw = false;
+    try {
+        truncated.finish();
+    } catch (const parse_error&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+// Records events as a compact trace; numbers go through a single double overload.
+struct TraceHandler {
+    std::string trace;
+
+    void on_null() { trace += "n "; }
+    void on_bool(bool b) { trace += b ? "t " : "f "; }
+    void on_number(double d) { trace += std::to_string(static_cast<long long>(d)) + " "; }
+    void on_string(StringRef s) { trace += "s:" + std::string(s.data(), s.size()) + " "; }
+    void on_key(StringRef s) { trace += "k:" + std::string(s.data(), s.size()) + " "; }
+    void start_object() { trace += "{ "; }
+    void end_object() { trace += "} "; }
+    void start_array() { trace += "[ "; }
+    void end_array() { trace += "] "; }
+};
+
+static void test_sax() {
+    TraceHandler trace;
+    sax_parse(std::string("{\"a\": [1, 2.0, true, null], \"b\\n\": {}, \"c\": \"x\\ty\", \"d\": []}"), trace);
+    assert(trace.trace == "{ k:a [ 1 2 t n ] k:b\n { } k:c s:x\ty k:d [ ] } ");
+
+    trace.trace.clear();
+    sax_parse(std::string("false"), trace);
+    assert(trace.trace == "f ");
+
+    // Events before the error are delivered; the error carries its offset.
+    trace.trace.clear();
+    size_t offset = 0;
+    try {
+        sax_parse(std::string("[1, 2 3]"), trace);
+    } catch (const parse_error& e) {
+        offset = e.offset();
+    }
+    assert(offset == 6 && trace.trace == "[ 1 2 ");
+}
+
+static void test_parse_lines() {
+    std::string text;
+    for (int i = 0; i < 2000; i++) {
+        text += "{\"id\": " + std::to_string(i) + ", \"tag\": \"r" + std::to_string(i % 7) + "\"}";
+        text += i % 5 == 0 ? "\r\n\n  \n" : "\n";
+    }
+
+    for (int mode = 0; mode < 4; mode++) {
+        bool ordered = mode & 1;
+        LineOptions options;
+        options.threads = 4;
+        options.chunk_size = 256;
+        options.ordered = ordered;
+        options.parse.indexed = mode >= 2;
+
+        std::vector<int> ids;
+        parse_lines(text, [&ids](JSONValue* v) {
+            std::unique_ptr<JSONValue> owned(v);
+            ids.push_back(dynamic_cast<JSONNumber*>((*dynamic_cast<JSONObject*>(v))["id"])->get<int>());
+        }, options);
+
+        assert(ids.size() == 2000);
+        if (!ordered) std::sort(ids.begin(), ids.end());
+        for (int i = 0; i < 2000; i++) assert(ids[i] == i);
+    }
+
+    // Errors report offsets into the whole input and stop delivery.
+    std::string bad = text + "{\"id\": 2000, }\n" + text;
+    size_t offset = 0;
+    LineOptions options;
+    options.chunk_size = 512;
+    try {
+        parse_lines(bad, [](JSONValue* v) { delete v; }, options);
+    } catch (const parse_error& e) {
+        offset = e.offset();
+    }
+    assert(offset == text.size() + 13);
+    LineOptions indexed = options;
+    indexed.parse.indexed = true;
+    offset = 0;
+    try {
+        parse_lines(bad, [](JSONValue* v) { delete v; }, indexed);
+    } catch (const parse_error& e) {
+        offset = e.offset();
+    }
+    assert(offset == text.size() + 13);
+
+    bool stopped = false;
+    size_t seen = 0;
+    try {
+        parse_lines(text, [&seen](JSONValue* v) {
+            delete v;
+            if (++seen == 10) throw std::runtime_error("enough");
+        }, options);
+    } catch (const std::runtime_error& e) {
+        stopped = std::string(e.what()) == "enough";
+    }
+    assert(stopped && seen == 10);
+}
+
+static void test_parse_file() {
+    const char* path = "jsonpp-test-file.json";
+    const std::string text = "{\"name\": \"a string long enough to borrow\", \"list\": [1, 2, 3]}\n";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << text;
+    }
+
+    std::unique_ptr<JSONValue> tree(parse_file(path));
+    std::unique_ptr<JSONValue> expected(parse(text));
+    assert(tree->to_string() == expected->to_string());
+
+    MappedFile mapped(path);
+    assert(mapped.size() == text.size() && std::memcmp(mapped.data(), text.data(), text.size()) == 0);
+
+    ParseOptions options;
+    options.borrow_strings = true;
+    Document doc;
+    doc.parse_file(path, options);
+    Document moved(std::move(doc));
+    assert(moved.root()->to_string() == expected->to_string());
+
+    std::remove(path);
+
+    bool threw = false;
+    try {
+        parse_file(path);
+    } catch (const std::system_error&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+static void test_moves() {
+    static_assert(std::is_nothrow_move_constructible<JSONArray>::value, "JSONArray move");
+    // Move assignment refuses frozen and shared containers (see test_frozen), so it may throw.
+    static_assert(std::is_move_assignable<JSONArray>::value, "JSONArray move assign");
+    static_assert(std::is_nothrow_move_constructible<JSONObject>::value, "JSONObject move");
+    static_assert(std::is_move_assignable<JSONObject>::value, "JSONObject move assign");
+    static_assert(std::is_nothrow_move_constructible<JSONCompactArray>::value, "JSONCompactArray move");
+    static_assert(std::is_move_assignable<JSONCompactArray>::value, "JSONCompactArray move assign");
+    static_assert(std::is_nothrow_move_constructible<JSONString>::value, "JSONString move");
+    static_assert(std::is_nothrow_move_assignable<JSONString>::value, "JSONString move assign");
+    static_assert(std::is_nothrow_move_constructible<JSONNumber>::value, "JSONNumber move");
+    static_assert(std::is_nothrow_move_constructible<JSONBooleanType>::value, "JSONBooleanType move");
+    static_assert(std::is_nothrow_move_constructible<JSONNullType>::value, "JSONNullType move");
+    static_assert(std::is_nothrow_move_constructible<Value>::value, "Value move");
+    static_assert(std::is_nothrow_move_assignable<Value>::value, "Value move assign");
+    static_assert(std::is_nothrow_move_constructible<Document>::value, "Document move");
+
+    // Moves hand over the children instead of cloning them.
+    JSONArray inner;
+    inner.emplace_back<JSONNumber>(1);
+    JSONString* text = inner.emplace_back<JSONString>(std::string("two"));
+    JSONArray moved(std::move(inner));
+    assert(inner.size() == 0 && moved.size() == 2 && moved[1] == text);
+
+    JSONObject obj;
+    obj.insert("list", std::move(moved));
+    assert(moved.size() == 0);
+    JSONArray* list = dynamic_cast<JSONArray*>(obj["list"]);
+    assert(list->size() == 2 && (*list)[1] == text);
+    obj.emplace<JSONBooleanType>("flag", true);
+    obj.insert("n", JSONNumber(3));
+    obj.insert("copy", *list);
+    assert(obj.to_string() == "{\"list\": [1, \"two\"], \"flag\": true, \"n\": 3, \"copy\": [1, \"two\"]}");
+
+    JSONObject target;
+    target.emplace<JSONNullType>("old");
+    target = std::move(obj);
+    assert(obj.size() == 0 && target.size() == 4 && !target.contains("old"));
+    assert(dynamic_cast<JSONArray*>(target["list"]) == list);
+
+    JSONString a("first"), b("second");
+    a = std::move(b);
+    assert(std::string(a) == "second" && b.size() == 0);
+
+    Value v(std::string("a string longer than fourteen"));
+    Value w;
+    w = std::move(v);
+    assert(w.str() == "a string longer than fourteen" && v.type() == ValueType::NULL_TYPE);
+
+    // Arena-backed containers allocate emplaced nodes in their arena.
+    Document doc;
+    JSONArray* root = doc.make_array();
+    doc.set_root(root);
+    root->emplace_back<JSONNumber>(7);
+    root->emplace_back<JSONArray>(root->arena())->push_back(JSONString("x", 1, root->arena()));
+    Document other(std::move(doc));
+    other = std::move(other);
+    assert(other.root()->to_string() == "[7, [\"x\"]]");
+
+    // A moved-from document starts a new arena rather than leaking heap nodes.
+    JSONValue* reparsed = doc.parse("[1, {\"k\": \"v\"}]");
+    assert(dynamic_cast<JSONArray*>(reparsed)->arena() == &doc.arena());
+    assert(doc.make_string("s")->to_string() == "\"s\"" && doc.make_object()->arena() == &doc.arena());
+    Document assigned;
+    assigned = std::move(other);
+    assert(other.make_array()->arena() == &other.arena());
+}
+
+static void test_handles() {
+    // Slots are read-only through operator[]; ownership only moves through explicit calls.
+    static_assert(!std::is_reference<decltype(std::declval<JSONArray&>()[0])>::value, "array slot");
+    static_assert(!std::is_reference<decltype(std::declval<JSONObject&>()["k"])>::value, "object slot");
+
+    JSONArray arr;
+    arr.push_back(nullptr);
+    arr.push_back(NodePtr(new JSONNumber(1)));
+    arr.push_back(std::unique_ptr<JSONString>(new JSONString("s")));
+    assert(arr.to_string() == "[null, 1, \"s\"]");
+
+    arr.set(0, std::unique_ptr<JSONBooleanType>(new JSONBooleanType(true)));
+    arr.set(1, nullptr);
+    NodePtr s = arr.take(2);
+    assert(arr.to_string() == "[true, null]" && std::string(*dynamic_cast<JSONString*>(s.get())) == "s");
+    // Putting an element back in its own slot keeps it.
+    arr.set(0, NodePtr(arr[0]));
+    assert(arr.to_string() == "[true, null]");
+    arr.erase(0);
+    assert(arr.size() == 1);
+
+    // A range of nodes is adopted the same way, nulls included.
+    std::vector<JSONValue*> nodes;
+    nodes.push_back(new JSONNumber(2));
+    nodes.push_back(nullptr);
+    JSONArray ranged(nodes.begin(), nodes.end());
+    assert(ranged.to_string() == "[2, null]");
+
+    JSONObject obj;
+    obj.insert("a", NodePtr(new JSONNumber(1)));
+    obj.insert("b", nullptr);
+    obj.insert("c", std::move(s));
+    assert(obj.to_string() == "{\"a\": 1, \"b\": null, \"c\": \"s\"}");
+    obj.insert("c", NodePtr(obj["c"]));
+    assert(obj.to_string() == "{\"a\": 1, \"b\": null, \"c\": \"s\"}");
+
+    bool missing = false;
+    try {
+        obj["zzz"];
+    } catch (const std::out_of_range&) {
+        missing = true;
+    }
+    assert(missing && obj.size() == 3);
+
+    NodePtr a = obj.take("a");
+    assert(a && dynamic_cast<JSONNumber*>(a.get())->get<int>() == 1);
+    assert(!obj.take("a") && obj.erase("b") && !obj.erase("b"));
+    assert(obj.to_string() == "{\"c\": \"s\"}");
+
+    // Removing members from an indexed object keeps lookups right.
+    JSONObject big;
+    for (int i = 0; i < 40; i++) big.insert("k" + std::to_string(i), NodePtr(new JSONNumber(i)));
+    for (int i = 0; i < 40; i += 3) assert(big.erase("k" + std::to_string(i)));
+    for (int i = 0; i < 40; i++) assert(big.contains("k" + std::to_string(i)) == (i % 3 != 0));
+    assert(dynamic_cast<JSONNumber*>(big["k38"])->get<int>() == 38);
+
+    // Nodes leaving an arena-backed tree are copies the caller can free.
+    Document doc;
+    JSONObject* root = dynamic_cast<JSONObject*>(doc.parse(std::string("{\"list\": [1, 2], \"x\": null}")));
+    NodePtr list = root->take("list");
+    assert(list->to_string() == "[1, 2]" && root->to_string() == "{\"x\": null}");
+}
+
+static void test_cow() {
+    // A heap copy shares nested containers and copies the modified path only.
+    std::unique_ptr<JSONValue> tree(parse("{\"a\": {\"b\": [1, 2]}, \"c\": [3], \"d\": \"s\"}"));
+    std::unique_ptr<JSONValue> copy(tree->clone());
+    JSONObject* original = dynamic_cast<JSONObject*>(tree.get());
+    JSONObject* cloned = dynamic_cast<JSONObject*>(copy.get());
+    const JSONObject* viewed = cloned;
+    assert((*viewed)["a"] == (*static_cast<const JSONObject*>(original))["a"] && (*viewed)["a"]->shared());
+    assert(!(*viewed)["d"]->shared());
+
+    JSONObject* a = dynamic_cast<JSONObject*>((*cloned)["a"]);
+    assert(!a->shared() && !(*static_cast<const JSONObject*>(original))["a"]->shared());
+    dynamic_cast<JSONArray*>((*a)["b"])->push_back(NodePtr(new JSONNumber(9)));
+    assert(copy->to_string() == "{\"a\": {\"b\": [1, 2, 9]}, \"c\": [3], \"d\": \"s\"}");
+    assert(tree->to_string() == "{\"a\": {\"b\": [1, 2]}, \"c\": [3], \"d\": \"s\"}");
+
+    // Shared nodes reached without going through a parent refuse to change.
+    const JSONValue* c = (*viewed)["c"];
+    bool refused = false;
+    try {
+        const_cast<JSONArray*>(dynamic_cast<const JSONArray*>(c))->push_back(nullptr);
+    } catch (const std::logic_error&) {
+        refused = true;
+    }
+    assert(refused && c->to_string() == "[3]");
+
+    // Either side can go away first.
+    tree.reset();
+    assert(!(*viewed)["c"]->shared() && copy->to_string() == "{\"a\": {\"b\": [1, 2, 9]}, \"c\": [3], \"d\": \"s\"}");
+
+    // take() hands out a private node.
+    std::unique_ptr<JSONValue> again(copy->clone());
+    NodePtr taken = dynamic_cast<JSONObject*>(again.get())->take("c");
+    dynamic_cast<JSONArray*>(taken.get())->push_back(nullptr);
+    assert((*viewed)["c"]->to_string() == "[3]" && !(*viewed)["c"]->shared());
+
+    // Compact arrays and Values share held containers the same way.
+    JSONCompactArray compact;
+    compact.push_back(Value(1));
+    compact.push_back(Value(static_cast<JSONValue*>(new JSONArray())));
+    JSONCompactArray compact_copy(compact);
+    const JSONCompactArray& compact_view = compact_copy;
+    assert(compact_view[1].node() == static_cast<const JSONCompactArray&>(compact)[1].node());
+    assert(compact_copy[1].node() != compact[1].node() && !compact[1].node()->shared());
+    dynamic_cast<JSONArray*>(compact_copy[1].node())->push_back(nullptr);
+    assert(compact.to_string() == "[1, []]" && compact_copy.to_string() == "[1, [null]]");
+
+    Value held(static_cast<JSONValue*>(new JSONObject()));
+    Value held_copy(held);
+    assert(held.node() == held_copy.node() && held.node()->shared());
+
+    // Arena documents are copied in full, so the copy outlives the arena.
+    Document doc;
+    doc.parse(std::string("[[1], {\"x\": [2]}]"));
+    std::unique_ptr<JSONValue> detached(doc.root()->clone());
+    doc = Document();
+    assert(detached->to_string() == "[[1], {\"x\": [2]}]");
+}
+
+static bool refuses(const std::function<void()>& change) {
+    try {
+        change();
+    } catch (const std::logic_error&) {
+        return true;
+    }
+    return false;
+}
+
+static void test_frozen() {
+    std::unique_ptr<JSONValue> tree(parse("{\"a\": {\"b\": [1, 2]}, \"c\": [3]}"));
+    JSONObject* root = dynamic_cast<JSONObject*>(tree.get());
+    const JSONObject* view = root;
+    JSONArray* b = dynamic_cast<JSONArray*>((*dynamic_cast<JSONObject*>((*root)["a"]))["b"]);
+    assert(freeze(root) == root && root->frozen() && b->frozen());
+
+    // Lookups still work; changes of any kind are refused.
+    assert((*view)["c"]->to_string() == "[3]" && view->contains("a"));
+    assert(refuses([&] { (*root)["a"]; }));
+    assert(refuses([&] { root->insert("d", nullptr); }));
+    assert(refuses([&] { root->erase("c"); }));
+    assert(refuses([&] { b->push_back(nullptr); }));
+    assert(refuses([&] { b->take(0); }));
+    // Moving out of a frozen container is refused rather than emptying it in place or copying it.
+    JSONArray stolen(std::move(*b));
+    assert(stolen.size() == 0 && !stolen.frozen() && b->to_string() == "[1, 2]");
+    // Move assignment refuses a frozen container on either side, leaving both as they were.
+    JSONArray other;
+    assert(refuses([&] { other = std::move(*b); }));
+    assert(refuses([&] { *b = JSONArray(); }));
+    assert(refuses([&] { *root = JSONObject(); }));
+    assert(other.size() == 0 && b->to_string() == "[1, 2]");
+    JSONObject whole(std::move(*root));
+    assert(whole.size() == 0);
+    assert(tree->to_string() == "{\"a\": {\"b\": [1, 2]}, \"c\": [3]}");
+
+    ParseOptions compact;
+    compact.compact_arrays = true;
+    std::unique_ptr<JSONValue> packed(parse("[1, \"two\"]", compact));
+    freeze(packed.get());
+    JSONCompactArray* values = dynamic_cast<JSONCompactArray*>(packed.get());
+    // Iteration is read-only, so it works on a frozen array even without a const view.
+    static_assert(std::is_same<JSONCompactArray::iterator, JSONCompactArray::const_iterator>::value, "const iteration");
+    size_t seen = 0;
+    for (const Value& v : *values) seen += v.type() != ValueType::NULL_TYPE;
+    assert(seen == 2);
+    JSONCompactArray unpacked(std::move(*values));
+    assert(unpacked.size() == 0);
+    assert(refuses([&] { *values = JSONCompactArray(); }));
+    assert(packed->to_string() == "[1, \"two\"]");
+
+    // So is moving out of a child that a copy still shares.
+    JSONObject original;
+    JSONArray items;
+    items.push_back(NodePtr(new JSONNumber(1)));
+    original.insert("list", std::move(items));
+    JSONObject sharing(original);
+    const JSONObject& view_of = original;
+    JSONArray* list = const_cast<JSONArray*>(dynamic_cast<const JSONArray*>(view_of["list"]));
+    assert(list->shared());
+    JSONArray taken(std::move(*list));
+    assert(taken.size() == 0 && list->shared());
+    assert(original.to_string() == "{\"list\": [1]}" && sharing.to_string() == "{\"list\": [1]}");
+
+    // Freezing a tree never marks nodes it still shares with another tree: they are copied first.
+    JSONObject live;
+    JSONArray inner;
+    inner.push_back(NodePtr(new JSONNumber(1)));
+    live.insert("list", std::move(inner));
+    std::unique_ptr<JSONValue> snapshot(live.clone());
+    const JSONValue* live_list = static_cast<const JSONObject&>(live)["list"];
+    assert(live_list->shared());
+    const JSONValue* frozen_root = freeze(snapshot.get());
+    const JSONValue* frozen_list = (*static_cast<const JSONObject*>(frozen_root))["list"];
+    assert(frozen_list != live_list && frozen_list->frozen());
+    assert(!live_list->frozen() && !live_list->shared() && snapshot->to_string() == live.to_string());
+    // The root itself cannot be swapped out, so a shared one is refused.
+    JSONObject holder(live);
+    assert(refuses([&] { freeze(const_cast<JSONValue*>(static_cast<const JSONObject&>(live)["list"])); }));
+
+    // A copy is writable, and copies the frozen nodes it changes.
+    std::unique_ptr<JSONValue> copy(tree->clone());
+    JSONObject* next = dynamic_cast<JSONObject*>(copy.get());
+    dynamic_cast<JSONArray*>((*next)["c"])->push_back(NodePtr(new JSONNumber(4)));
+    assert(copy->to_string() == "{\"a\": {\"b\": [1, 2]}, \"c\": [3, 4]}");
+    tree.reset();
+    dynamic_cast<JSONArray*>((*dynamic_cast<JSONObject*>((*next)["a"]))["b"])->erase(0);
+    assert(copy->to_string() == "{\"a\": {\"b\": [2]}, \"c\": [3, 4]}");
+
+    // Readers keep whichever version they loaded while writers publish new ones.
+    AtomicTree config;
+    assert(!config.load());
+    config.publish(NodePtr(parse("{\"version\": 0, \"copies\": [0, 0]}")));
+
+    std::atomic<bool> done(false);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.push_back(std::thread([&] {
+            int seen = 0;
+            while (!done.load()) {
+                AtomicTree::Snapshot snapshot = config.load();
+                const JSONObject& obj = dynamic_cast<const JSONObject&>(*snapshot);
+                int version = dynamic_cast<const JSONNumber*>(obj["version"])->get<int>();
+                const JSONArray& copies = dynamic_cast<const JSONArray&>(*obj["copies"]);
+                for (const JSONValue* v : copies) assert(dynamic_cast<const JSONNumber*>(v)->get<int>() == version);
+                assert(version >= seen);
+                seen = version;
+            }
+        }));
+    }
+
+    for (int version = 1; version <= 50; version++) {
+        std::string text = "{\"version\": " + std::to_string(version) + ", \"copies\": [" +
+                           std::to_string(version) + ", " + std::to_string(version) + "]}";
+        if (version % 2) {
+            config.publish(NodePtr(parse(text)));
+        } else {
+            Document doc;
+            doc.parse(text);
+            AtomicTree::Snapshot old = config.publish(std::move(doc));
+            assert(old && old->frozen());
+        }
+    }
+    done = true;
+    for (std::thread& reader : readers) reader.join();
+
+    AtomicTree::Snapshot last = config.load();
+    assert(last->frozen() && last->to_string() == "{\"version\": 50, \"copies\": [50, 50]}");
+}
+
+static void test_pointer() {
+    // The examples from RFC 6901, section 5.
+    std::string text = "{\"foo\": [\"bar\", \"baz\"], \"\": 0, \"a/b\": 1, \"c%d\": 2, \"e^f\": 3, \"g|h\": 4, "
+                       "\"i\\\\j\": 5, \"k\\\"l\": 6, \" \": 7, \"m~n\": 8}";
+    std::unique_ptr<JSONValue> doc(parse(text));
+    LazyDocument lazy(text);
+    const char* cases[][2] = {
+        {"", nullptr}, {"/foo", "[\"bar\", \"baz\"]"}, {"/foo/0", "\"bar\""}, {"/", "0"}, {"/a~1b", "1"},
+        {"/c%d", "2"}, {"/e^f", "3"}, {"/g|h", "4"}, {"/i\\j", "5"}, {"/k\"l", "6"}, {"/ ", "7"}, {"/m~0n", "8"},
+    };
+    for (auto& c : cases) {
+        JSONPointer pointer(c[0]);
+        assert(pointer.to_string() == c[0]);
+        std::string expected = c[1] ? c[1] : doc->to_string();
+        assert(pointer.find(doc.get())->to_string() == expected);
+        std::unique_ptr<JSONValue> target(pointer.at(lazy.root()).materialize());
+        assert(target->to_string() == expected);
+    }
+
+    // With duplicate keys both paths resolve to the last member.
+    const std::string dup_text = "{\"a\": {\"b\": 1}, \"a\": {\"b\": 2}, \"a\": {\"b\": 3}}";
+    std::unique_ptr<JSONValue> dup_doc(parse(dup_text));
+    LazyDocument dup_lazy(dup_text);
+    JSONPointer dup_pointer("/a/b");
+    assert(dup_pointer.find(dup_doc.get())->to_string() == "3");
+    assert(dup_pointer.at(dup_lazy.root()).number<int>() == 3);
+
+    JSONPointer escaped("/a~1b~01/x");
+    assert(escaped.size() == 2 && std::string(escaped.token(0).data(), escaped.token(0).size()) == "a/b~1");
+
+    // Missing members, bad indices and steps into scalars find nothing.
+    for (const char* missing : {"/nope", "/foo/2", "/foo/-", "/foo/01", "/foo/x", "/foo/0/bar", "/a~1b/0"}) {
+        JSONPointer pointer(missing);
+        assert(pointer.find(doc.get()) == nullptr);
+        bool thrown = false;
+        try {
+            pointer.at(lazy.root());
+        } catch (const std::out_of_range&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    for (const char* bad : {"foo", "/~", "/~2", "/a~"}) {
+        bool thrown = false;
+        try {
+            JSONPointer pointer(bad);
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    // Large objects are searched through their index with the token's stored hash; compact arrays
+    // resolve to the containers they hold.
+    JSONObject big;
+    for (int i = 0; i < 40; i++) big.insert("k" + std::to_string(i), NodePtr(new JSONNumber(i)));
+    assert(JSONPointer("/k37").find(&big)->to_string() == "37");
+
+    ParseOptions options;
+    options.compact_arrays = true;
+    std::unique_ptr<JSONValue> compact(parse("{\"rows\": [1, {\"id\": 7}]}", options));
+    assert(JSONPointer("/rows/1/id").find(compact.get())->to_string() == "7");
+    assert(JSONPointer("/rows/2").find(compact.get()) == nullptr);
+    bool inline_scalar = false;
+    try {
+        JSONPointer("/rows/0").find(compact.get());
+    } catch (const std::domain_error&) {
+        inline_scalar = true;
+    }
+    assert(inline_scalar);
+}
+
+namespace shop {
+    struct Price {
+        int64_t cents;
+        std::string currency;
+    };
+    JSONPP_BIND(Price, cents, currency)
+
+    struct Item {
+        std::string name;
+        uint32_t count;
+        bool active;
+        double weight;
+        uint64_t serial;
+        Price price;
+        std::vector<std::string> tags;
+        std::vector<Price> history;
+    };
+    JSONPP_BIND(Item, name, count, active, weight, serial, price, tags, history)
+
+    // axb and ayb share a length and first and last characters, so they meet in the key table.
+    struct Flags {
+        std::vector<bool> bits;
+        int axb;
+        int ayb;
+    };
+    JSONPP_BIND(Flags, bits, axb, ayb)
+}
+
+static bool bind_fails(const std::string& text, size_t offset) {
+    shop::Item item;
+    try {
+        from_json(text, item);
+    } catch (const parse_error& e) {
+        return e.offset() == offset;
+    }
+    return false;
+}
+
+static void test_binding() {
+    std::string text = "{\"name\": \"lamp \\u00e9\", \"count\": 3, \"active\": true, \"weight\": 1.5, "
+                       "\"serial\": 12345678901, \"price\": {\"cents\": -250, \"currency\": \"EUR\"}, "
+                       "\"tags\": [\"a\", \"b\"], \"history\": [{\"cents\": 1, \"currency\": \"X\"}]}";
+    shop::Item item;
+    from_json(text, item);
+    assert(item.name == "lamp \xc3\xa9" && item.count == 3 && item.active && item.weight == 1.5);
+    assert(item.serial == 12345678901 && item.price.cents == -250 && item.price.currency == "EUR");
+    assert(item.tags.size() == 2 && item.tags[1] == "b" && item.history.size() == 1 && item.history[0].cents == 1);
+
+    // Writing gives the same text a tree would, in any format.
+    std::unique_ptr<JSONValue> tree(parse(text));
+    assert(to_json(item) == tree->to_string());
+    assert(to_json(item, Format::pretty(2)) == tree->to_string(Format::pretty(2)));
+    assert(to_json(std::vector<shop::Price>()) == "[]");
+
+    // Unsigned fields take the whole uint64_t range, past what a tree keeps as an integer.
+    uint64_t big = 0;
+    from_json("18446744073709551615", big);
+    assert(big == UINT64_MAX && to_json(big) == "18446744073709551615");
+
+    // Members may come in any order; unknown ones are skipped and missing ones left as they were.
+    shop::Item partial;
+    partial.count = 7;
+    from_json("{\"extra\": {\"deep\": [1, {\"x\": null}, \"s\"]}, \"price\": {\"currency\": \"USD\", \"cents\": 5}, "
+              "\"name\": \"n\", \"more\": []}", partial);
+    assert(partial.count == 7 && partial.name == "n" && partial.price.cents == 5 && partial.price.currency == "USD");
+
+    std::vector<int> numbers;
+    from_json(" [1, 2, 3] ", numbers);
+    assert(numbers.size() == 3 && numbers[2] == 3);
+
+    shop::Flags flags;
+    from_json("{\"ayb\": 2, \"bits\": [true, false, true], \"axb\": 1}", flags);
+    assert(flags.bits.size() == 3 && flags.bits[0] && !flags.bits[1] && flags.axb == 1 && flags.ayb == 2);
+    assert(to_json(flags) == "{\"bits\": [true, false, true], \"axb\": 1, \"ayb\": 2}");
+
+    // Type mismatches, out-of-range numbers and bad syntax report where they are.
+    assert(bind_fails("{\"count\": \"3\"}", 10));
+    assert(bind_fails("{\"count\": -1}", 10));
+    assert(bind_fails("{\"count\": 4294967296}", 10));
+    assert(bind_fails("{\"count\": 1.5}", 10));
+    assert(bind_fails("{\"price\": {\"cents\": 1,}}", 22));
+    assert(bind_fails("{\"other\": [1 2]}", 13));
+    assert(bind_fails("{\"name\": \"x\"} x", 14));
+    assert(bind_fails("[]", 0));
+}
+
+static void test_node_pool() {
+    // A freed node's block is handed back to the next allocation of the same type on this thread.
+    trim_node_pools();
+    JSONNumber* first = new JSONNumber(1);
+    void* block = first;
+    delete first;
+    JSONNumber* second = new JSONNumber(2);
+#ifndef JSONPP_NO_NODE_POOL
+    assert(static_cast<void*>(second) == block);
+#else
+    (void)block;
+#endif
+    delete second;
+
+    // Churn through a mutable tree; nodes are recycled through create()/clone() as well.
+    JSONObject session;
+    for (int round = 0; round < 100; round++) {
+        JSONArray* items = session.emplace<JSONArray>("items");
+        for (int i = 0; i < 50; i++) items->push_back(JSONNumber(i));
+        NodePtr copy(items->clone());
+        assert(copy->to_string() == items->to_string());
+        assert(session.erase("items"));
+    }
+    assert(session.size() == 0);
+
+    // Nodes may be freed on a different thread from the one that created them.
+    JSONArray* shared = new JSONArray();
+    std::thread([shared]() {
+        shared->push_back(JSONString("worker"));
+        NodePtr owned(shared->create());
+    }).join();
+    assert(shared->to_string() == "[\"worker\"]");
+    std::thread([shared]() { delete shared; }).join();
+
+    trim_node_pools();
+}
+
+static void test_format() {
+    std::unique_ptr<JSONValue> root(parse("{\"a\": [1, 2.5, {}], \"b\": {\"c\": null, \"d\": []}, \"e\": \"x\\n\\u0001\\\"\"}"));
+
+    assert(root->to_string() == "{\"a\": [1, 2.5, {}], \"b\": {\"c\": null, \"d\": []}, \"e\": \"x\\n\\u0001\\\"\"}");
+    assert(root->to_string(Format::compact()) == "{\"a\":[1,2.5,{}],\"b\":{\"c\":null,\"d\":[]},\"e\":\"x\\n\\u0001\\\"\"}");
+    assert(root->to_string(Format::pretty(2)) ==
+           "{\n"
+           "  \"a\": [\n"
+           "    1,\n"
+           "    2.5,\n"
+           "    {}\n"
+           "  ],\n"
+           "  \"b\": {\n"
+           "    \"c\": null,\n"
+           "    \"d\": []\n"
+           "  },\n"
+           "  \"e\": \"x\\n\\u0001\\\"\"\n"
+           "}");
+
+    // The sizing pass agrees with what is written, in every layout and node representation.
+    ParseOptions compact;
+    compact.compact_arrays = true;
+    const char* text = "[{\"k\": [true, false, -7, 1e300, \"a long string with\\ttabs and \\u00e9\"]}, [[], [[1]]], \"\\u001f\"]";
+    std::unique_ptr<JSONValue> heap(parse(text));
+    std::unique_ptr<JSONValue> packed(parse(text, compact));
+    Format formats[] = {Format(), Format::compact(), Format::pretty(), Format::pretty(100)};
+    for (const Format& format : formats) {
+        std::string out = heap->to_string(format);
+        assert(heap->serialized_size(format) == out.size());
+        assert(packed->serialized_size(format) == out.size() && packed->to_string(format) == out);
+
+        std::vector<char> buffer(heap->serialized_size(format));
+        BufferWriter writer(buffer.data(), buffer.size());
+        writer.set_format(format);
+        heap->serialize(writer);
+        assert(!writer.overflowed() && std::string(buffer.begin(), buffer.end()) == out);
+        assert(parse_str(escape_str(out)) == out && escaped_size(out.data(), out.size()) == escape_str(out).size());
+    }
+
+    // Output can start nested, for embedding in a larger pretty document.
+    JSONArray arr;
+    arr.push_back(JSONNumber(1));
+    std::string nested;
+    StringWriter writer(nested);
+    writer.set_format(Format::pretty(2), 1);
+    arr.serialize(writer);
+    assert(nested == "[\n    1\n  ]");
+}
+
+static std::string hex_bytes(const std::string& bytes) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (unsigned char c : bytes) {
+        out += digits[c >> 4];
+        out += digits[c & 15];
+    }
+    return out;
+}
+
+static std::string unhex(const char* text) {
+    std::string out;
+    for (; text[0] && text[1]; text += 2) out += static_cast<char>(std::stoi(std::string(text, 2), nullptr, 16));
+    return out;
+}
+
+static std::string binary_of(const char* json) {
+    std::unique_ptr<JSONValue> root(parse(json));
+    return hex_bytes(to_binary(*root));
+}
+
+static bool binary_fails(const char* hex, size_t offset) {
+    try {
+        delete from_binary(unhex(hex));
+    } catch (const parse_error& e) {
+        return e.offset() == offset;
+    }
+    return false;
+}
+
+static void test_binary() {
+    // Encodings from RFC 8949, appendix A.
+    assert(binary_of("0") == "00" && binary_of("23") == "17" && binary_of("24") == "1818");
+    assert(binary_of("1000") == "1903e8" && binary_of("1000000000000") == "1b000000e8d4a51000");
+    assert(binary_of("-1") == "20" && binary_of("-1000") == "3903e7");
+    assert(binary_of("1.1") == "fb3ff199999999999a" && binary_of("-4.1") == "fbc010666666666666");
+    assert(binary_of("[false, true, null]") == "83f4f5f6");
+    assert(binary_of("[1, [2, 3], [4, 5]]") == "8301820203820405");
+    assert(binary_of("{\"a\": 1, \"b\": [2, 3]}") == "a26161016162820203");
+    assert(binary_of("\"IETF\"") == "6449455446" && binary_of("\"\\u00fc\"") == "62c3bc");
+
+    // Decoding widens what has no exact node form.
+    std::unique_ptr<JSONValue> wide(from_binary(unhex("84f93c00fa47c350001bffffffffffffffff3bffffffffffffffff")));
+    assert(wide->to_string() == "[1.0, 100000.0, 1.8446744073709552e+19, -1.8446744073709552e+19]");
+
+    const char* text = "{\"id\": -9223372036854775808, \"max\": 9223372036854775807, \"pi\": 3.141592653589793, "
+                       "\"tags\": [\"a tag too long to inline\", \"\", \"x\\ny\"], \"nested\": {\"deep\": [[[]], {}]}, \"ok\": true}";
+    std::unique_ptr<JSONValue> root(parse(text));
+    std::string bytes = to_binary(*root);
+    std::unique_ptr<JSONValue> back(from_binary(bytes));
+    assert(back->to_string() == root->to_string());
+
+    // Compact arrays encode the same way, and decode through the usual parse options.
+    ParseOptions options;
+    options.compact_arrays = true;
+    options.borrow_strings = true;
+    std::string source(text);
+    std::unique_ptr<JSONValue> packed(parse(source, options));
+    assert(to_binary(*packed) == bytes);
+
+    Document doc;
+    JSONObject* obj = dynamic_cast<JSONObject*>(doc.from_binary(bytes, options));
+    assert(obj && obj->to_string() == root->to_string());
+    JSONCompactArray* tags = dynamic_cast<JSONCompactArray*>((*obj)["tags"]);
+    assert(tags && (*tags)[0].data() > bytes.data() && (*tags)[0].data() < bytes.data() + bytes.size());
+
+    // Non-finite doubles have no text form but survive the binary round trip.
+    JSONArray special;
+    special.push_back(JSONNumber(std::numeric_limits<double>::infinity()));
+    std::unique_ptr<JSONValue> inf(from_binary(to_binary(special)));
+    assert(std::isinf(dynamic_cast<JSONNumber*>((*dynamic_cast<JSONArray*>(inf.get()))[0])->get<double>()));
+
+    assert(binary_fails("", 0));
+    assert(binary_fails("8201", 0));
+    assert(binary_fails("821901", 1));
+    assert(binary_fails("19ff", 0));
+    assert(binary_fails("9f01ff", 0));
+    assert(binary_fails("4161", 0));
+    assert(binary_fails("c001", 0));
+    assert(binary_fails("a10102", 1));
+    assert(binary_fails("f7", 0));
+    assert(binary_fails("0101", 1));
+    assert(binary_fails("9bffffffffffffffff", 0));
+    assert(binary_fails("62c3", 0));
+}
+
+// Whether parsing text (as JSON, or as CBOR when binary) under limits fails with what at offset.
+static bool over_limit(const std::string& text, const ParseLimits& limits, const char* what, size_t offset,
+                       bool binary = false) {
+    ParseOptions options;
+    options.limits = limits;
+    try {
+        delete (binary ? from_binary(text, options) : parse(text, options));
+    } catch (const parse_error& e) {
+        return e.message() == what && e.offset() == offset;
+    }
+    return false;
+}
+
+static bool within(const std::string& text, const ParseLimits& limits, bool binary = false) {
+    ParseOptions options;
+    options.limits = limits;
+    delete (binary ? from_binary(text, options) : parse(text, options));
+    return true;
+}
+
+// Whether feeding pieces to a PushParser under limits fails with what at offset.
+static bool push_over_limit(const std::vector<std::string>& pieces, const ParseLimits& limits, const char* what,
+                            size_t offset) {
+    PushParser parser([](JSONValue* v) { delete v; }, 0, limits);
+    try {
+        for (const std::string& piece : pieces) parser.feed(piece);
+        parser.finish();
+    } catch (const parse_error& e) {
+        return e.message() == what && e.offset() == offset;
+    }
+    return false;
+}
+
+static bool push_within(const std::vector<std::string>& pieces, const ParseLimits& limits) {
+    PushParser parser([](JSONValue* v) { delete v; }, 0, limits);
+    for (const std::string& piece : pieces) parser.feed(piece);
+    parser.finish();
+    return true;
+}
+
+static void test_limits() {
+    ParseLimits depth;
+    depth.max_depth = 2;
+    assert(within("[[1], {\"a\": 2}]", depth));
+    assert(over_limit("[[1], {\"a\": []}]", depth, "nesting too deep", 12));
+
+    ParseLimits bytes;
+    bytes.max_bytes = 8;
+    assert(within("[1,2,33]", bytes));
+    assert(over_limit("[1, 2, 3, 4]", bytes, "input too large", 8));
+
+    ParseLimits strings;
+    strings.max_string_length = 3;
+    assert(within("{\"abc\": \"a\\nc\"}", strings));
+    assert(over_limit("[\"abc\", \"abcd\"]", strings, "string too long", 8));
+    assert(over_limit("{\"abcd\": 1}", strings, "string too long", 1));
+    assert(over_limit("[\"ab\\u00e9\"]", strings, "string too long", 1));
+
+    ParseLimits members;
+    members.max_members = 2;
+    assert(within("[[1, 2], {\"a\": 1, \"b\": [3, 4]}]", members));
+    assert(over_limit("[1, [2, 3], 4]", members, "too many members", 12));
+    assert(over_limit("{\"a\": 1, \"b\": 2, \"c\": 3}", members, "too many members", 22));
+
+    ParseLimits nodes;
+    nodes.max_nodes = 4;
+    assert(within("[1, [2]]", nodes));
+    assert(over_limit("[1, {\"a\": 2, \"b\": 3}]", nodes, "too many values", 18));
+
+    // The same limits guard binary input: [[1, 2], "abcd"] and {"a": [1]}.
+    assert(within(unhex("828201026461626364"), depth, true));
+    assert(over_limit(unhex("828201026461626364"), strings, "string too long", 4, true));
+    ParseLimits one;
+    one.max_members = 1;
+    assert(over_limit(unhex("828201026461626364"), one, "too many members", 0, true));
+    depth.max_depth = 1;
+    assert(over_limit(unhex("a161618101"), depth, "nesting too deep", 3, true));
+    assert(within(unhex("a161618101"), nodes, true));
+    nodes.max_nodes = 2;
+    assert(over_limit(unhex("a161618101"), nodes, "too many values", 4, true));
+
+    // Records in a stream each get the whole budget.
+    LineOptions lines;
+    lines.parse.limits.max_nodes = 3;
+    size_t count = 0;
+    parse_lines("[1, 2]\n[3, 4]\n", [&](JSONValue* v) { delete v; count++; }, lines);
+    assert(count == 2);
+
+    // Escaped strings stop being unescaped once they are over, even without a closing quote.
+    std::string unterminated = "[\"\\n" + std::string(1000, 'a');
+    assert(over_limit(unterminated, strings, "string too long", 1));
+    assert(over_limit("[\"" + std::string(1000, 'a') + "\\n", strings, "string too long", 1));
+    assert(over_limit("[\"a\\nbcd\"]", strings, "string too long", 1));
+
+    // The push parser applies the same limits as the stream arrives.
+    assert(push_over_limit({"[[[1]]]"}, depth, "nesting too deep", 1));
+    assert(push_over_limit({"[1, ", "2, 3]"}, members, "too many members", 7));
+    assert(push_over_limit({"[1, [2]]"}, nodes, "too many values", 4));
+    ParseLimits three;
+    three.max_nodes = 3;
+    assert(push_within({"[1, 2] [3, ", "4]"}, three));
+    assert(push_over_limit({"[1, 2, ", "3]"}, bytes, "input too large", 8));
+    assert(push_within({"[\"\\u0041\\u", "0042\"]"}, strings));
+    assert(push_over_limit({"[\"abcd\"]"}, strings, "string too long", 1));
+    assert(push_over_limit({"[\"a\\n", "bcd\"]"}, strings, "string too long", 1));
+    // Split tokens are dropped once they could no longer fit, long before they end.
+    std::vector<std::string> pieces(1, "[\"ab");
+    pieces.resize(100, "cdefgh");
+    assert(push_over_limit(pieces, strings, "string too long", 1));
+    // Numbers are not held to max_string_length, and where the pieces break does not matter.
+    std::string digits = "[1234567890123456789012345678901]";
+    std::vector<std::string> results;
+    for (size_t cut : {digits.size(), size_t(10), size_t(20)}) {
+        PushParser parser([&results](JSONValue* v) { results.push_back(v->to_string()); delete v; }, 0, strings);
+        parser.feed(digits.substr(0, cut));
+        parser.feed(digits.substr(cut));
+        parser.finish();
+    }
+    assert(results.size() == 3 && results[0] == results[1] && results[0] == results[2]);
+    std::string huge = "[1" + std::string(5000, '0') + "]";
+    assert(push_over_limit({huge}, strings, "number too long", 1));
+    pieces.assign(1000, "000000");
+    pieces[0] = "[1";
+    assert(push_over_limit(pieces, strings, "number too long", 1));
+    assert(push_over_limit({"[tru", "eeeeee"}, strings, "invalid literal", 1));
+}
+
+// Whether parsing text fails with what at offset.
+static bool parse_error_at(const std::string& text, const char* what, size_t offset) {
+    try {
+        delete parse(text);
+    } catch (const parse_error& e) {
+        return e.message() == what && e.offset() == offset;
+    }
+    return false;
+}
+
+static void test_utf8() {
+    const char* good[] = {"", "plain", "\xc3\xa9", "\xe2\x82\xac", "\xef\xbf\xbf", "\xf0\x9d\x84\x9e", "\xf4\x8f\xbf\xbf",
+                          "\xed\x9f\xbf", "\xee\x80\x80"};
+    for (const char* g : good) assert(valid_utf8(g));
+
+    // Stray continuation, overlong forms, surrogates, past U+10FFFF, truncated and never-valid bytes.
+    const char* bad[] = {"\x80", "\xc0\xaf", "\xc1\xbf", "\xe0\x80\xaf", "\xe0\x9f\xbf", "\xf0\x80\x80\xaf",
+                         "\xf0\x8f\xbf\xbf", "\xed\xa0\x80", "\xed\xbf\xbf", "\xf4\x90\x80\x80", "\xf5\x80\x80\x80",
+                         "\xe2\x82", "\xf0\x9d\x84", "\xc3", "\xff", "\xc3\x28", "\xe2\x28\xac"};
+    for (const char* b : bad) {
+        assert(!valid_utf8(b));
+        assert(parse_error_at(std::string("\"") + b + "\"", "invalid UTF-8", 1));
+    }
+
+    // Long strings take the vector path; errors are found exactly wherever they fall, including
+    // sequences split across blocks and cut off at the end.
+    std::string text;
+    while (text.size() < 200) text += "ab\xc3\xa9\xe2\x82\xac\xf0\x9d\x84\x9e";
+    assert(valid_utf8(text));
+    for (size_t i = 0; i < 128; i++) {
+        std::string broken = text;
+        broken[i] = '\xff';
+        assert(!valid_utf8(broken));
+        // The first byte of the character at i, unless i is a lead, is the one rejected.
+        size_t at = i;
+        while (at && (static_cast<unsigned char>(text[at]) & 0xC0) == 0x80) --at;
+        assert(parse_error_at("\"" + broken + "\"", "invalid UTF-8", at + 1));
+
+        std::string cut = text.substr(0, 64 + i);
+        bool whole = 64 + i == text.size() || (static_cast<unsigned char>(text[64 + i]) & 0xC0) != 0x80;
+        assert(valid_utf8(cut) == whole);
+    }
+
+    // Validation covers escaped strings and keys, can be turned off, and does not mind escapes.
+    assert(parse_error_at("[\"a\\n\xc3\"]", "invalid UTF-8", 5));
+    assert(parse_error_at("{\"k\xff\": 1}", "invalid UTF-8", 3));
+    ParseOptions raw;
+    raw.validate_utf8 = false;
+    std::unique_ptr<JSONValue> loose(parse("[\"\xff\", \"\\ud834\"]", raw));
+    assert(std::string(*dynamic_cast<JSONString*>((*dynamic_cast<JSONArray*>(loose.get()))[1])) == "\xed\xa0\xb4");
+
+    // Surrogate pairs decode to one character; either half alone is rejected.
+    std::unique_ptr<JSONValue> clef(parse("\"\\ud834\\udd1e \\u00e9\""));
+    assert(std::string(*dynamic_cast<JSONString*>(clef.get())) == "\xf0\x9d\x84\x9e \xc3\xa9");
+    assert(parse_error_at("\"\\ud834\"", "invalid surrogate escape", 1));
+    assert(parse_error_at("\"a\\ud834\\u0041\"", "invalid surrogate escape", 2));
+    assert(parse_error_at("\"\\udd1e\\ud834\"", "invalid surrogate escape", 1));
+    assert(parse_str("\\ud834\\udd1e") == "\xf0\x9d\x84\x9e");
+
+    // The other readers validate too.
+    assert(binary_fails("62c328", 1));
+    bool threw = false;
+    try {
+        LazyDocument("[\"\xe2\x82\"]").root()[0].str();
+    } catch (const parse_error& e) {
+        threw = e.offset() == 2;
+    }
+    assert(threw);
+    PushParser push([](JSONValue* v) { delete v; });
+    threw = false;
+    try {
+        push.feed("[\"ok\", \"\xc3");
+        push.feed("\"]");
+        push.finish();
+    } catch (const parse_error& e) {
+        threw = e.offset() == 8;
+    }
+    assert(threw);
+
+    // ASCII output escapes everything past 0x7f, and reads back as the same text.
+    Format ascii;
+    ascii.ascii = true;
+    std::unique_ptr<JSONValue> doc(parse("{\"caf\xc3\xa9\": [\"\xe2\x82\xac\\n\", \"\xf0\x9d\x84\x9e/\"]}"));
+    std::string out = doc->to_string(ascii);
+    assert(out == "{\"caf\\u00e9\": [\"\\u20ac\\n\", \"\\ud834\\udd1e\\/\"]}");
+    assert(doc->serialized_size(ascii) == out.size());
+    std::unique_ptr<JSONValue> back(parse(out));
+    assert(back->to_string() == doc->to_string());
+
+    JSONString invalid("a\xff\xe2\x82");
+    assert(invalid.to_string(ascii) == "\"a\\ufffd\\ufffd\\ufffd\"");
+    assert(invalid.serialized_size(ascii) == invalid.to_string(ascii).size());
+    ascii.indent = 2;
+    assert(doc->serialized_size(ascii) == doc->to_string(ascii).size());
+}
+
+#if defined(JSONPP_INSTRUMENTATION)
+static void test_instrumentation() {
+    InstrumentationCounters counters;
+    assert(set_instrumentation(&counters) == nullptr);
+
+    std::unique_ptr<JSONValue> root(parse("{\"a\": [1, [2, [3]]], \"b\": \"long enough to need its own buffer\"}"));
+    assert(counters.documents == 1 && counters.bytes_parsed == 63 && counters.max_depth == 4);
+    assert(counters.nodes == 8 && counters.allocations > 0 && counters.bytes_allocated > 0);
+
+    uint64_t nodes = counters.nodes;
+    // The clone copies the root and its string member; the nested array is shared.
+    delete root->clone();
+    delete root->create();
+    assert(counters.nodes == nodes + 3);
+
+    Document doc;
+    doc.parse(std::string("[true, null]"));
+    assert(counters.nodes == nodes + 6 && counters.documents == 2);
+
+    std::string out = root->to_string();
+    assert(counters.serializations == 1 && counters.bytes_serialized == out.size());
+
+    // Failed parses are not reported.
+    assert(parse_fails("[[1]"));
+    assert(counters.documents == 2);
+
+    assert(set_instrumentation(nullptr) == &counters);
+    delete parse("[1]");
+    assert(counters.documents == 2);
+}
+#endif
+
+int main() {
+    test_parse();
+    test_string_scan();
+    test_escape();
+    test_serialize();
+    test_document();
+    test_compact();
+    test_numbers();
+    test_object();
+    test_key_pool();
+    test_borrow_strings();
+    test_structural_index();
+    test_indexed_parse();
+    test_lazy();
+    test_push_parser();
+    test_sax();
+    test_parse_lines();
+    test_parse_file();
+    test_moves();
+    test_handles();
+    test_cow();
+    test_frozen();
+    test_pointer();
+    test_binding();
+    test_limits();
+    test_utf8();
+    test_node_pool();
+    test_format();
+    test_binary();
+#if defined(JSONPP_INSTRUMENTATION)
+    test_instrumentation();
+#endif
+
+    std::cout << "all tests passed" << std::endl;
+    return 0;
+}